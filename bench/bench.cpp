@@ -0,0 +1,293 @@
+// Throughput benchmarks of the calculator components:
+//   calc_fold_bench [lines]
+// Every benchmark prints its name, the number of items, the time and the rate.
+#include "batch.h"
+#include "calc.h"
+#include "corpus.h"
+#include "divisor.h"
+#include "mapped_output.h"
+#include "output.h"
+#include "parallel.h"
+#include "script.h"
+#include "session.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void report(const std::string & name, const std::uint64_t items, const std::uint64_t bytes, const Clock::duration elapsed)
+{
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    std::cout << std::left << std::setw(28) << name << std::right
+              << std::setw(12) << items << " items "
+              << std::fixed << std::setprecision(3) << std::setw(9) << seconds * 1000 << " ms "
+              << std::setw(9) << items / seconds / 1e6 << " M/s";
+    if (bytes != 0) {
+        std::cout << std::setw(9) << bytes / seconds / (1 << 20) << " MiB/s";
+    }
+    std::cout << std::defaultfloat << std::endl;
+}
+
+// Formats values into a pipe drained by another thread, flushing every 4096
+// values as the driver does after every block of input
+void output_to_pipe(const std::string & name, const std::vector<double> & values, const bool splice)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return;
+    }
+    std::thread reader([fd = fds[0]] {
+        std::vector<char> buffer(1 << 16);
+        while (read(fd, buffer.data(), buffer.size()) > 0) {
+        }
+    });
+    const auto start = Clock::now();
+    std::uint64_t bytes = 0;
+    bool spliced = false;
+    {
+        Output output(fds[1], splice);
+        spliced = output.splicing();
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            output.put(values[i]);
+            if (i % 4096 == 4095) {
+                output.flush();
+            }
+        }
+        output.flush();
+        bytes = output.bytes();
+    }
+    close(fds[1]);
+    reader.join();
+    close(fds[0]);
+    report(name + (splice && !spliced ? " (write)" : ""), values.size(), bytes, Clock::now() - start);
+}
+
+// Evaluates folds of 1000 arguments with a register of type T
+template <class T>
+void engine_folds(const std::string & name, const std::size_t lines)
+{
+    std::string fold = "(*)";
+    for (std::size_t i = 0; i < 1000; ++i) {
+        fold += " 1.0000001";
+    }
+    const std::size_t count = std::max<std::size_t>(lines / 1000, 1);
+    T current = 1;
+    const auto start = Clock::now();
+    for (std::size_t i = 0; i < count; ++i) {
+        calc::evaluate(current, fold);
+    }
+    report(name, count * 1000, 0, Clock::now() - start);
+}
+
+// Evaluates independent single operation requests on registers of type T
+template <class T>
+void engine_batch(const std::string & name, const std::size_t lines)
+{
+    const std::string_view ops[] = {"+ 1.5", "- 2.5", "* 3", "/ 4", "SQRT", "_"};
+    std::vector<std::string_view> requests(lines);
+    std::vector<T> registers(lines);
+    for (std::size_t i = 0; i < lines; ++i) {
+        requests[i] = ops[i % std::size(ops)];
+        registers[i] = static_cast<T>(i % 1000);
+    }
+    const auto start = Clock::now();
+    calc::evaluate_batch(registers.data(), requests.data(), lines, nullptr);
+    report(name, lines, 0, Clock::now() - start);
+}
+
+// Divides or takes remainders of integers by one divisor, with the plain
+// operation and with calc::Divisor
+void repeated_divisor(const std::string & name, const std::size_t lines, const double d, const bool remainder)
+{
+    std::vector<double> values(lines);
+    for (std::size_t i = 0; i < lines; ++i) {
+        values[i] = static_cast<double>(i * 2654435761u % 1000000007u);
+    }
+    auto plain = values;
+    auto start = Clock::now();
+    for (auto & value : plain) {
+        value = remainder ? std::fmod(value, d) : value / d;
+    }
+    report(name + ", plain", lines, 0, Clock::now() - start);
+    start = Clock::now();
+    const calc::Divisor divisor(d);
+    if (remainder) {
+        divisor.remainder(values.data(), lines);
+    }
+    else {
+        divisor.divide(values.data(), lines);
+    }
+    report(name + ", divisor", lines, 0, Clock::now() - start);
+    if (values != plain) {
+        std::cout << name << ": results differ" << std::endl;
+    }
+}
+
+// Evaluates a generated corpus line by line like calc_fold does, without
+// the input and output
+void corpus(const std::string & kind, const std::size_t lines)
+{
+    std::string text;
+    generate_corpus(kind, lines, 1, text);
+    calc::Session session;
+    std::ostringstream err;
+    const auto start = Clock::now();
+    std::size_t count = 0;
+    for (std::size_t begin = 0; begin < text.size(); ++count) {
+        const auto end = text.find('\n', begin);
+        session.eval(std::string_view(text).substr(begin, end - begin), err);
+        begin = end + 1;
+        if (count % 1024 == 0) {
+            err.str({});
+        }
+    }
+    report("corpus: " + kind, count, text.size(), Clock::now() - start);
+}
+
+// Compounding loop of a two operation body: as separate lines, as a repeat
+// which iterates and as a repeat collapsed into a closed form
+void compounding(const std::size_t lines)
+{
+    std::ostringstream err;
+    calc::Session session({}, 1);
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < lines; ++i) {
+        session.eval("* 1.0000001", err);
+        session.eval("+ 0.5", err);
+    }
+    report("repeat: separate lines", lines, 0, Clock::now() - start);
+    const std::string loop = "repeat " + std::to_string(lines) + " { * 1.0000001; + 0.5 }";
+    for (const bool affine : {false, true}) {
+        calc::Script script(affine);
+        calc::Session looped({}, 1);
+        start = Clock::now();
+        script.feed(looped, loop, err);
+        report(affine ? "repeat: closed form" : "repeat: iterated", lines, 0, Clock::now() - start);
+    }
+}
+
+// Sums square roots of values first written by the threads which reduce
+// them, on 1 thread, the CPUs of one node and all CPUs of all nodes
+void node_scaling(const std::size_t lines)
+{
+    const auto & topology = Topology::system();
+    std::vector<unsigned> thread_counts = {1};
+    if (topology.nodes() > 1) {
+        thread_counts.push_back(static_cast<unsigned>(topology.cpus(0).size()));
+    }
+    unsigned all = 0;
+    for (std::size_t node = 0; node < topology.nodes(); ++node) {
+        all += static_cast<unsigned>(topology.cpus(node).size());
+    }
+    if (all > thread_counts.back()) {
+        thread_counts.push_back(all);
+    }
+    for (const unsigned threads : thread_counts) {
+        std::unique_ptr<double[]> values(new double[lines]);
+        parallel_for(threads, threads, [&](const std::size_t i) {
+            for (std::size_t k = lines * i / threads; k < lines * (i + 1) / threads; ++k) {
+                values[k] = static_cast<double>(k);
+            }
+        });
+        const auto map = [&](const std::size_t begin, const std::size_t end) {
+            double partial = 0;
+            for (std::size_t k = begin; k < end; ++k) {
+                partial += std::sqrt(values[k]);
+            }
+            return partial;
+        };
+        const auto start = Clock::now();
+        const double sum = parallel_reduce(lines, threads, 0.0, map, [](const double a, const double b) { return a + b; });
+        const auto elapsed = Clock::now() - start;
+        const std::size_t nodes = std::min<std::size_t>(topology.nodes(), threads);
+        report("reduce: x" + std::to_string(threads) + " on " + std::to_string(nodes) + " node(s)", lines, lines * sizeof(double), elapsed);
+        if (!(sum > 0) && lines > 1) {
+            std::cout << "reduce: bad sum" << std::endl;
+        }
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const std::size_t lines = argc > 1 ? std::stoull(argv[1]) : 10000000;
+    std::cout << "build flavor: " << CALC_BUILD_FLAVOR << std::endl;
+
+    std::vector<double> values(lines);
+    for (std::size_t i = 0; i < lines; ++i) {
+        values[i] = std::sqrt(static_cast<double>(i)) * 1234.5;
+    }
+    {
+        // Formatting alone: writes to /dev/null cost next to nothing
+        const int null = open("/dev/null", O_WRONLY);
+        const auto start = Clock::now();
+        Output output(null);
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            output.put(values[i]);
+        }
+        output.flush();
+        report("output: format only", values.size(), output.bytes(), Clock::now() - start);
+        close(null);
+    }
+    {
+        const int null = open("/dev/null", O_WRONLY);
+        const auto start = Clock::now();
+        Output output(null);
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            output.put(static_cast<float>(values[i]));
+        }
+        output.flush();
+        report("output: format only, float", values.size(), output.bytes(), Clock::now() - start);
+        close(null);
+    }
+    output_to_pipe("output: write(2) to pipe", values, false);
+    output_to_pipe("output: vmsplice to pipe", values, true);
+    engine_folds<double>("engine: folds, double", lines);
+    engine_folds<float>("engine: folds, float", lines);
+    engine_batch<double>("engine: batch, double", lines);
+    engine_batch<float>("engine: batch, float", lines);
+    repeated_divisor("divide: / 3", lines, 3, false);
+    repeated_divisor("divide: / 8", lines, 8, false);
+    repeated_divisor("remainder: % 7", lines, 7, true);
+    repeated_divisor("remainder: % 0.25", lines, 0.25, true);
+    for (const auto * kind : {"folds", "errors", "mixed"}) {
+        corpus(kind, lines / 10);
+    }
+    compounding(lines);
+    node_scaling(lines);
+    std::vector<unsigned> thread_counts = {1};
+    if (std::thread::hardware_concurrency() > 1) {
+        thread_counts.push_back(std::thread::hardware_concurrency());
+    }
+    for (const unsigned threads : thread_counts) {
+        const std::string path = "calc_fold_bench.out";
+        const auto start = Clock::now();
+        MappedOutput output(path, threads);
+        for (const double value : values) {
+            output.put(value);
+        }
+        output.close();
+        const auto elapsed = Clock::now() - start;
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        report("output: mmapped file x" + std::to_string(threads), values.size(), static_cast<std::uint64_t>(file.tellg()), elapsed);
+        std::remove(path.c_str());
+    }
+}
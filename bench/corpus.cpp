@@ -0,0 +1,16 @@
+// Writes a generated corpus (see corpus.h) to the standard output:
+//   calc_fold_corpus folds|errors|mixed lines [seed]
+#include "corpus.h"
+
+#include <iostream>
+#include <string>
+
+int main(int argc, char ** argv)
+{
+    std::string text;
+    if (argc < 3 || !generate_corpus(argv[1], std::stoull(argv[2]), argc > 3 ? std::stoull(argv[3]) : 1, text)) {
+        std::cerr << "Usage: calc_fold_corpus folds|errors|mixed lines [seed]" << std::endl;
+        return 2;
+    }
+    std::cout << text << std::flush;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Generated inputs representative of production workloads, used for PGO
+// training (calc_fold_corpus) and by calc_fold_bench:
+//   folds  - folds of 10-200 arguments with plain operations in between
+//   errors - mostly malformed lines: unknown operations, bad arguments,
+//            division by zero, unary suffixes
+//   mixed  - plain operations, short folds and a few errors
+// The same kind, number of lines and seed always give the same text.
+inline bool generate_corpus(const std::string_view kind, const std::size_t lines, std::uint64_t seed, std::string & text)
+{
+    if (kind != "folds" && kind != "errors" && kind != "mixed") {
+        return false;
+    }
+    const auto next = [&seed](const std::uint64_t n) {
+        // xorshift64*
+        seed ^= seed >> 12;
+        seed ^= seed << 25;
+        seed ^= seed >> 27;
+        return (seed * 0x2545F4914F6CDD1DULL >> 32) % n;
+    };
+    const auto number = [&] {
+        return std::to_string(next(1000)) + (next(2) != 0 ? "." + std::to_string(next(1000)) : "");
+    };
+    const auto fold = [&](const std::size_t length) {
+        const char * ops[] = {"(+)", "(-)", "(*)", "(/)"};
+        std::string line = ops[next(4)];
+        for (std::size_t i = 0; i < length; ++i) {
+            line += ' ' + (next(4) == 0 ? "1" : number());
+        }
+        return line;
+    };
+    const auto plain = [&] {
+        const char * ops[] = {"+ ", "- ", "* ", "/ ", "% ", "^ "};
+        switch (next(8)) {
+        case 0: return std::string("SQRT");
+        case 1: return std::string("_");
+        default: return ops[next(6)] + number();
+        }
+    };
+    const auto error = [&] {
+        switch (next(6)) {
+        case 0: return "FOO " + number();
+        case 1: return "+ " + number() + "x";
+        case 2: return std::string("/ 0");
+        case 3: return std::string("_ 1");
+        case 4: return std::string("+");
+        default: return "(+) 1 2 " + number() + "z";
+        }
+    };
+    seed = seed * 2 + 1;
+    for (std::size_t i = 0; i < lines; ++i) {
+        // Keep the register in a sensible range
+        if (i % 64 == 63) {
+            text += "1\n";
+            continue;
+        }
+        const auto roll = next(100);
+        if (kind == "folds") {
+            text += roll < 70 ? fold(10 + next(191)) : plain();
+        }
+        else if (kind == "errors") {
+            text += roll < 80 ? error() : plain();
+        }
+        else {
+            text += roll < 75 ? plain() : (roll < 95 ? fold(2 + next(15)) : error());
+        }
+        text += '\n';
+    }
+    return true;
+}
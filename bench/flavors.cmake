@@ -0,0 +1,77 @@
+# Speedups of the optimized build flavors, run by the bench_flavors target:
+#   cmake -DSOURCE_DIR=<repo> -DBINARY_DIR=<dir> -DCXX_COMPILER=<c++> -DLINES=<n> -P flavors.cmake
+# Builds calc_fold_bench as RELEASE, RELEASE_LTO and RELEASE_PGO in
+# BINARY_DIR/<flavor>, runs it with LINES and prints the time of every
+# benchmark with its speedup over RELEASE.
+
+set(FLAVORS RELEASE RELEASE_LTO RELEASE_PGO)
+
+foreach(FLAVOR ${FLAVORS})
+    set(DIR ${BINARY_DIR}/${FLAVOR})
+    execute_process(COMMAND ${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${DIR} -DCMAKE_BUILD_TYPE=${FLAVOR} -DCMAKE_CXX_COMPILER=${CXX_COMPILER}
+        OUTPUT_QUIET RESULT_VARIABLE RESULT)
+    if (RESULT EQUAL 0)
+        execute_process(COMMAND ${CMAKE_COMMAND} --build ${DIR} --target calc_fold_bench
+            OUTPUT_QUIET RESULT_VARIABLE RESULT)
+    endif()
+    if (NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "Cannot build the ${FLAVOR} flavor in ${DIR}")
+    endif()
+    execute_process(COMMAND ${DIR}/bench/calc_fold_bench ${LINES}
+        OUTPUT_VARIABLE OUTPUT RESULT_VARIABLE RESULT)
+    if (NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "calc_fold_bench of the ${FLAVOR} flavor failed")
+    endif()
+    # Times in microseconds by benchmark name, e.g. "output: format only   10000000 items  1234.567 ms ..."
+    string(REPLACE "\n" ";" LINES_OF_OUTPUT "${OUTPUT}")
+    set(NAMES_${FLAVOR} "")
+    foreach(LINE ${LINES_OF_OUTPUT})
+        if (LINE MATCHES "^(.*[^ ]) +[0-9]+ items +([0-9]+)\\.([0-9][0-9][0-9]) ms")
+            set(NAME "${CMAKE_MATCH_1}")
+            math(EXPR MICROSECONDS "${CMAKE_MATCH_2} * 1000 + 1${CMAKE_MATCH_3} - 1000")
+            string(MAKE_C_IDENTIFIER "${NAME}" KEY)
+            set(TIME_${FLAVOR}_${KEY} ${MICROSECONDS})
+            list(APPEND NAMES_${FLAVOR} "${NAME}")
+        endif()
+    endforeach()
+endforeach()
+
+# Fixed point with three decimals
+function(ratio OUT NUMERATOR DENOMINATOR)
+    if (DENOMINATOR EQUAL 0)
+        set(${OUT} "-" PARENT_SCOPE)
+        return()
+    endif()
+    math(EXPR THOUSANDTHS "${NUMERATOR} * 1000 / ${DENOMINATOR}")
+    math(EXPR WHOLE "${THOUSANDTHS} / 1000")
+    math(EXPR FRACTION "${THOUSANDTHS} % 1000 + 1000")
+    string(SUBSTRING ${FRACTION} 1 3 FRACTION)
+    set(${OUT} "${WHOLE}.${FRACTION}x" PARENT_SCOPE)
+endfunction()
+
+# Pads text with spaces to width
+function(pad OUT TEXT WIDTH)
+    set(PADDED "${TEXT}                                        ")
+    string(SUBSTRING "${PADDED}" 0 ${WIDTH} PADDED)
+    set(${OUT} "${PADDED}" PARENT_SCOPE)
+endfunction()
+
+pad(HEADER "benchmark" 30)
+message("${HEADER}RELEASE ms    RELEASE_LTO   RELEASE_PGO")
+foreach(NAME ${NAMES_RELEASE})
+    string(MAKE_C_IDENTIFIER "${NAME}" KEY)
+    set(BASE ${TIME_RELEASE_${KEY}})
+    math(EXPR BASE_MS "${BASE} / 1000")
+    pad(ROW "${NAME}" 30)
+    pad(CELL "${BASE_MS}" 14)
+    set(ROW "${ROW}${CELL}")
+    foreach(FLAVOR RELEASE_LTO RELEASE_PGO)
+        set(SPEEDUP "-")
+        if (DEFINED TIME_${FLAVOR}_${KEY})
+            ratio(SPEEDUP ${BASE} ${TIME_${FLAVOR}_${KEY}})
+        endif()
+        pad(CELL "${SPEEDUP}" 14)
+        set(ROW "${ROW}${CELL}")
+    endforeach()
+    message("${ROW}")
+endforeach()
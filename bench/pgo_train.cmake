@@ -0,0 +1,44 @@
+# PGO training run, started by a RELEASE_PGO build:
+#   cmake -DCALC_FOLD=<instrumented calc_fold> -DCORPUS=<calc_fold_corpus> -DWORK_DIR=<dir> -P pgo_train.cmake
+# Generates the fold-heavy, error-heavy and mixed corpora and runs calc_fold
+# over them in the modes used in production; the instrumented binary writes
+# the profile on exit.
+
+set(TRAINING_LINES 200000)
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+foreach(KIND folds errors mixed)
+    execute_process(COMMAND ${CORPUS} ${KIND} ${TRAINING_LINES}
+        OUTPUT_FILE ${WORK_DIR}/${KIND}.txt
+        RESULT_VARIABLE RESULT)
+    if (NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "Cannot generate the ${KIND} corpus")
+    endif()
+endforeach()
+
+# Runs calc_fold with the given arguments, input is the corpus given by INPUT.
+# Exit code 1 only reports malformed lines (--check).
+function(train INPUT)
+    execute_process(COMMAND ${CALC_FOLD} ${ARGN}
+        INPUT_FILE ${WORK_DIR}/${INPUT}.txt
+        OUTPUT_FILE ${WORK_DIR}/out.txt
+        ERROR_FILE ${WORK_DIR}/err.txt
+        RESULT_VARIABLE RESULT)
+    if (NOT RESULT MATCHES "^[01]$")
+        message(FATAL_ERROR "Training run failed: calc_fold ${ARGN} < ${INPUT}.txt")
+    endif()
+endfunction()
+
+train(folds)
+train(errors)
+train(errors --error-examples 10 --error-summary-every 100000)
+train(mixed)
+train(mixed --sequences)
+train(mixed --digest)
+train(mixed --check)
+
+# Batch mode over the corpus files themselves
+execute_process(COMMAND ${CALC_FOLD} --jobs 2 ${WORK_DIR}/folds.txt ${WORK_DIR}/errors.txt ${WORK_DIR}/mixed.txt
+    OUTPUT_QUIET ERROR_QUIET)
+file(REMOVE ${WORK_DIR}/out.txt ${WORK_DIR}/err.txt)
+message(STATUS "PGO training done")
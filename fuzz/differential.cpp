@@ -0,0 +1,264 @@
+// Differential fuzz target: feeds the same lines to the library engine, the
+// batch engine, the header-only engine and the frozen reference engine, then
+// compares resulting values and diagnostics.
+//
+// Built with CALC_FOLD_LIBFUZZER defined it exposes LLVMFuzzerTestOneInput,
+// otherwise it is a standalone driver generating grammar-aware random lines:
+//   calc_fold_fuzz [iterations] [seed]
+#include "batch.h"
+#include "calc.h"
+#include "calc_constexpr.h"
+#include "reference.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace {
+
+struct Outcome
+{
+    double value;
+    std::string diagnostics;
+};
+
+template <class Engine>
+Outcome run(Engine && engine, const double current, const std::string & line)
+{
+    std::ostringstream err;
+    auto * const old = std::cerr.rdbuf(err.rdbuf());
+    const double value = engine(current, line);
+    std::cerr.rdbuf(old);
+    return {value, err.str()};
+}
+
+// Zero tolerance means bitwise equality, otherwise values are compared with
+// the given relative tolerance
+bool same_value(const double a, const double b, const double tolerance)
+{
+    if (std::isnan(a) || std::isnan(b)) {
+        return std::isnan(a) && std::isnan(b);
+    }
+    if (tolerance == 0) {
+        std::uint64_t a_bits, b_bits;
+        std::memcpy(&a_bits, &a, sizeof(a));
+        std::memcpy(&b_bits, &b, sizeof(b));
+        return a_bits == b_bits;
+    }
+    return a == b || std::fabs(a - b) <= tolerance * std::fmax(1, std::fabs(b));
+}
+
+std::string printable(const std::string & line)
+{
+    std::ostringstream out;
+    for (const char c : line) {
+        if (std::isprint(static_cast<unsigned char>(c))) {
+            out << c;
+        }
+        else {
+            out << "\\x" << std::hex << static_cast<int>(static_cast<unsigned char>(c)) << std::dec;
+        }
+    }
+    return out.str();
+}
+
+// Returns false and reports the divergence if engines disagree
+bool compare(const double current, const std::string & line, double & result, const double tolerance = 0)
+{
+    const auto expected = run(reference::process_line, current, line);
+    const auto actual = run([](const double c, const std::string & l) { return process_line(c, l); }, current, line);
+    const double header_only = calc::eval(current, line);
+    double silent = current;
+    const bool ok = calc::evaluate(silent, line) == calc::Status::Ok;
+    double batched = current;
+    const std::string_view view = line;
+    const bool batch_ok = calc::evaluate_batch(&batched, &view, 1, nullptr) == 0;
+    result = expected.value;
+    if (same_value(actual.value, expected.value, tolerance) && actual.diagnostics == expected.diagnostics && same_value(header_only, expected.value, tolerance) && same_value(silent, expected.value, tolerance) && ok == expected.diagnostics.empty() &&
+        same_value(batched, expected.value, tolerance) && batch_ok == ok) {
+        return true;
+    }
+    std::cerr.precision(std::numeric_limits<double>::max_digits10);
+    std::cerr << "Divergence on register " << current << ", line '" << printable(line) << "'\n"
+              << "  reference:   " << expected.value << ", diagnostics '" << printable(expected.diagnostics) << "'\n"
+              << "  actual:      " << actual.value << ", diagnostics '" << printable(actual.diagnostics) << "'\n"
+              << "  header-only: " << header_only << "\n"
+              << "  silent:      " << silent << (ok ? ", ok" : ", failed") << "\n"
+              << "  batch:       " << batched << (batch_ok ? ", ok" : ", failed") << std::endl;
+    return false;
+}
+
+class LineGenerator
+{
+public:
+    explicit LineGenerator(const std::uint64_t seed)
+        : m_rng(seed)
+    {
+    }
+
+    double current(const double previous)
+    {
+        static const double interesting[] = {
+                0,
+                -0.0,
+                1,
+                -1,
+                0.5,
+                -2.5,
+                1e-300,
+                1e300,
+                std::numeric_limits<double>::max(),
+                std::numeric_limits<double>::infinity(),
+                -std::numeric_limits<double>::infinity(),
+                std::numeric_limits<double>::quiet_NaN()};
+        if (chance(90)) {
+            return previous;
+        }
+        return interesting[below(std::size(interesting))];
+    }
+
+    std::string line()
+    {
+        std::string line = chance(80) ? grammar_line() : random_line();
+        if (chance(10)) {
+            mutate(line);
+        }
+        return line;
+    }
+
+private:
+    bool chance(const unsigned percent) { return below(100) < percent; }
+
+    std::size_t below(const std::size_t n) { return std::uniform_int_distribution<std::size_t>(0, n - 1)(m_rng); }
+
+    std::string spaces()
+    {
+        static const char ws[] = {' ', ' ', ' ', '\t', '\v', '\r'};
+        std::string res(1 + below(chance(90) ? 2 : 8), ' ');
+        for (auto & c : res) {
+            c = ws[below(sizeof(ws))];
+        }
+        return res;
+    }
+
+    std::string number()
+    {
+        std::string res;
+        const std::size_t digits = chance(95) ? 1 + below(10) : 11 + below(4);
+        const std::size_t dot = chance(40) ? below(digits + 1) : digits + 1;
+        for (std::size_t i = 0; i < digits; ++i) {
+            if (i == dot) {
+                res += '.';
+            }
+            res += static_cast<char>('0' + (chance(15) ? 0 : below(10)));
+        }
+        if (dot == digits) {
+            res += '.';
+        }
+        return res;
+    }
+
+    std::string op()
+    {
+        static const char * const ops[] = {"+", "-", "*", "/", "%", "^", "_", "SQRT", "S", "SQ", "SQR", "x", ""};
+        return ops[below(chance(95) ? 8 : std::size(ops))];
+    }
+
+    std::string grammar_line()
+    {
+        if (chance(10)) {
+            return number();
+        }
+        const bool fold = chance(50);
+        std::string res = op();
+        if (fold) {
+            res = (chance(95) ? "(" : "((") + res + (chance(95) ? ")" : "");
+        }
+        const std::size_t args = fold ? below(8) : below(2);
+        for (std::size_t i = 0; i < args; ++i) {
+            if (i > 0 || chance(70)) {
+                res += spaces();
+            }
+            res += chance(3) ? std::string("0") : number();
+        }
+        if (chance(10)) {
+            res += spaces();
+        }
+        return res;
+    }
+
+    std::string random_line()
+    {
+        static const char alphabet[] = "0123456789.+-*/%^_SQRT() \t,x";
+        std::string res(below(16), ' ');
+        for (auto & c : res) {
+            c = chance(95) ? alphabet[below(sizeof(alphabet) - 1)] : static_cast<char>(below(256));
+        }
+        return res;
+    }
+
+    void mutate(std::string & line)
+    {
+        if (line.empty() || chance(50)) {
+            line.insert(below(line.size() + 1), 1, static_cast<char>(below(128)));
+        }
+        else {
+            line.erase(below(line.size()), 1);
+        }
+    }
+
+    std::mt19937_64 m_rng;
+};
+
+} // anonymous namespace
+
+#ifdef CALC_FOLD_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t * data, std::size_t size)
+{
+    double current = 0;
+    if (size >= sizeof(current)) {
+        std::memcpy(&current, data, sizeof(current));
+        data += sizeof(current);
+        size -= sizeof(current);
+    }
+    std::string line(reinterpret_cast<const char *>(data), size);
+    line.erase(std::min(line.find('\n'), line.size()));
+    double result;
+    if (!compare(current, line, result)) {
+        std::abort();
+    }
+    return 0;
+}
+
+#else
+
+int main(int argc, char ** argv)
+{
+    const std::uint64_t iterations = argc > 1 ? std::stoull(argv[1]) : 100000;
+    const std::uint64_t seed = argc > 2 ? std::stoull(argv[2]) : std::random_device{}();
+    const std::uint64_t max_reports = 10;
+
+    LineGenerator generator(seed);
+    std::uint64_t divergences = 0;
+    double current = 0;
+    for (std::uint64_t n = 0; n < iterations && divergences < max_reports; ++n) {
+        current = generator.current(current);
+        if (!compare(current, generator.line(), current)) {
+            ++divergences;
+        }
+    }
+    std::cout << "seed " << seed << ": " << iterations << " lines, " << divergences << " divergences" << std::endl;
+    return divergences == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+
+namespace reference {
+
+double process_line(double current, const std::string & line);
+
+} // namespace reference
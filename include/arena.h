@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator over a list of chunks. Memory is released all at once by
+// reset() (or back to a marker by rewind()), which is O(1) and keeps the
+// chunks for reuse, so a steady-state workload stops calling malloc.
+// Objects placed into the arena are never destroyed.
+class Arena
+{
+public:
+    static const std::size_t default_chunk_size = 1 << 20;
+
+    struct Marker
+    {
+        std::size_t chunk;
+        std::size_t offset;
+        std::size_t base;
+    };
+
+    // Restores the arena to the state of its construction when the scope ends
+    class Scope
+    {
+    public:
+        explicit Scope(Arena & arena)
+            : m_arena(arena)
+            , m_marker(arena.mark())
+        {
+        }
+        Scope(const Scope &) = delete;
+        Scope & operator=(const Scope &) = delete;
+        ~Scope() { m_arena.rewind(m_marker); }
+
+    private:
+        Arena & m_arena;
+        const Marker m_marker;
+    };
+
+    explicit Arena(std::size_t chunk_size = default_chunk_size);
+
+    void * allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+    template <class T>
+    T * allocate_array(const std::size_t n)
+    {
+        return static_cast<T *>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    Marker mark() const { return {m_chunk, m_offset, m_base}; }
+    void rewind(const Marker & marker);
+    void reset() { rewind({0, 0, 0}); }
+
+    // Bytes handed out since the last reset, including alignment padding
+    // and unused tails of chunks
+    std::size_t used() const { return m_base + m_offset; }
+    std::size_t peak() const { return m_peak; }
+    std::size_t capacity() const { return m_capacity; }
+
+private:
+    struct Chunk
+    {
+        std::unique_ptr<unsigned char[]> data;
+        std::size_t size;
+    };
+
+    std::vector<Chunk> m_chunks;
+    std::size_t m_chunk_size;
+    std::size_t m_chunk = 0;
+    std::size_t m_offset = 0;
+    // Total size of the chunks before the current one
+    std::size_t m_base = 0;
+    std::size_t m_peak = 0;
+    std::size_t m_capacity = 0;
+};
+
+// Arena of the calling thread for short-lived scratch data
+Arena & thread_arena();
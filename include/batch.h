@@ -0,0 +1,36 @@
+#pragma once
+
+#include "calc.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace calc {
+
+// Evaluates count independent requests: lines[i] is applied to registers[i]
+// with the semantics of evaluate(). Requests with one built-in operation and
+// at most one argument are grouped by operation and applied over contiguous
+// arrays, the rest (folds, plugin operations, malformed lines) go through the
+// scalar engine. No diagnostics are written; statuses may be null.
+// Returns the number of failed requests.
+std::size_t evaluate_batch(double * registers, const std::string_view * lines, std::size_t count, Status * statuses);
+// Same with single precision registers, twice as many lanes per vector
+std::size_t evaluate_batch(float * registers, const std::string_view * lines, std::size_t count, Status * statuses);
+
+// Bitmap of failed lanes: bit i % 64 of word i / 64 is set if lane i failed
+inline std::size_t error_words(const std::size_t count)
+{
+    return (count + 63) / 64;
+}
+
+// Applies SQRT to count registers in place. Registers which aren't positive
+// are left unchanged and marked in errors (error_words(count) words, may be
+// null). Returns the number of such registers.
+std::size_t sqrt_batch(double * registers, std::size_t count, std::uint64_t * errors);
+std::size_t sqrt_batch(float * registers, std::size_t count, std::uint64_t * errors);
+// Applies NEG to count registers in place, it never fails
+void neg_batch(double * registers, std::size_t count);
+void neg_batch(float * registers, std::size_t count);
+
+} // namespace calc
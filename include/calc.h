@@ -1,5 +1,94 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
 #include <string>
+#include <string_view>
 
 double process_line(double current, const std::string & line);
+
+// Validates a line without evaluating it: only lexing, argument and
+// zero-divisor checks are performed. Diagnostics are written to err.
+bool check_line(std::string_view line, std::ostream & err);
+
+namespace calc {
+
+// Outcome of a line evaluation, one value per class of diagnostics
+enum class Status
+{
+    Ok,
+    UnknownOperation,  // "Unknown operation ..."
+    BadFold,           // "Incorrect folded operation specified ..."
+    BadArgument,       // "Argument parsing error at ..."
+    ArgumentTooLong,   // "Argument isn't fully parsed, suffix left: ..."
+    MissingArgument,   // "No argument for a binary operation"
+    UnarySuffix,       // "Unexpected suffix for a unary operation: ..."
+    DivisionByZero,    // "Bad right argument for division: ..."
+    RemainderByZero,   // "Bad right argument for remainder: ..."
+    BadSqrt,           // "Bad argument for SQRT: ..."
+    OperationFailed,   // "Bad argument for <plugin operation>: ..."
+    LineTooLong,       // "Line too long: ..."
+    TooManyArguments,  // "Too many arguments, limit ..."
+    TimeLimitExceeded, // "Time limit exceeded after ... arguments"
+    SessionExhausted,  // "Session limit exceeded ..."
+};
+
+// Per-line resource limits, zero means unlimited
+struct LineLimits
+{
+    std::size_t max_bytes = 0;
+    std::size_t max_arguments = 0;
+    // Thread CPU time, checked periodically while folding
+    std::chrono::nanoseconds max_time{0};
+};
+
+// What the engine recognised in a line, filled even if it fails
+struct LineInfo
+{
+    // 0 if no operation was recognised, 1-9 for SET ADD SUB MUL DIV REM NEG
+    // POW SQRT, plugin operations follow in the order of registration
+    unsigned op = 0;
+    // Arguments accepted so far: the fold length, 1 for a plain binary
+    // operation and 0 for a unary one
+    std::size_t arguments = 0;
+};
+
+// Diagnostics sink discarding everything (per thread)
+std::ostream & null_stream();
+
+// Decides by status whether a diagnostic is worth formatting
+class DiagnosticFilter
+{
+public:
+    virtual bool wants(Status status) const = 0;
+
+protected:
+    ~DiagnosticFilter() = default;
+};
+
+// Attaches a filter to a diagnostics stream (nullptr detaches it). The
+// engine writes every diagnostic through diagnostics(), so those of unwanted
+// statuses are never formatted.
+void set_diagnostic_filter(std::ostream & err, const DiagnosticFilter * filter);
+// err, or null_stream() if the filter of err doesn't want status
+std::ostream & diagnostics(std::ostream & err, Status status);
+
+// Applies a line to the register, which is left unchanged on any error.
+// Diagnostics are written to err, the overload without it is silent.
+Status evaluate(double & current, std::string_view line, std::ostream & err);
+Status evaluate(double & current, std::string_view line);
+// Same, aborting the line as soon as it exceeds the limits
+Status evaluate(double & current, std::string_view line, std::ostream & err, const LineLimits & limits);
+// Same, also describing the line in info
+Status evaluate(double & current, std::string_view line, std::ostream & err, const LineLimits & limits, LineInfo & info);
+
+// Single precision engine: the register, the arithmetic and the results are
+// float, arguments are parsed exactly as for double and rounded once. Plugin
+// kernels run in double and their results are rounded.
+Status evaluate(float & current, std::string_view line, std::ostream & err);
+Status evaluate(float & current, std::string_view line);
+Status evaluate(float & current, std::string_view line, std::ostream & err, const LineLimits & limits);
+Status evaluate(float & current, std::string_view line, std::ostream & err, const LineLimits & limits, LineInfo & info);
+
+} // namespace calc
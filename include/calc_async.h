@@ -0,0 +1,86 @@
+#pragma once
+
+// Awaitable evaluation for C++20 coroutines (the library itself is C++17):
+//
+//   calc::AsyncEvaluator calc(pool);
+//   const calc::Status status = co_await calc.eval_async(reg, line);
+//
+// Lines up to inline_bytes long are evaluated inside co_await without
+// suspending. Longer ones are evaluated on the worker pool and the coroutine
+// is resumed on the worker thread; to continue on its own executor it should
+// schedule itself there after the co_await. Nothing is allocated per call:
+// the awaiter lives in the coroutine frame and is queued intrusively.
+// The register and the line must stay valid until the co_await completes.
+
+#include "calc.h"
+#include "worker_pool.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <string_view>
+
+namespace calc {
+
+class AsyncEvaluator
+{
+public:
+    static const std::size_t default_inline_bytes = 4096;
+
+    class Awaiter : private WorkerPool::Task
+    {
+    public:
+        Awaiter(const AsyncEvaluator & owner, double & current, const std::string_view line)
+            : m_owner(owner)
+            , m_current(current)
+            , m_line(line)
+        {
+            run = &Awaiter::evaluate_on_worker;
+        }
+
+        bool await_ready()
+        {
+            if (m_line.size() > m_owner.m_inline_bytes) {
+                return false;
+            }
+            m_status = evaluate(m_current, m_line);
+            return true;
+        }
+
+        void await_suspend(const std::coroutine_handle<> handle)
+        {
+            m_handle = handle;
+            m_owner.m_pool.submit(*this);
+        }
+
+        Status await_resume() const { return m_status; }
+
+    private:
+        static void evaluate_on_worker(WorkerPool::Task & task)
+        {
+            auto & self = static_cast<Awaiter &>(task);
+            self.m_status = evaluate(self.m_current, self.m_line);
+            self.m_handle.resume();
+        }
+
+        const AsyncEvaluator & m_owner;
+        double & m_current;
+        const std::string_view m_line;
+        Status m_status = Status::Ok;
+        std::coroutine_handle<> m_handle;
+    };
+
+    explicit AsyncEvaluator(WorkerPool & pool, const std::size_t inline_bytes = default_inline_bytes)
+        : m_pool(pool)
+        , m_inline_bytes(inline_bytes)
+    {
+    }
+
+    // Applies the line to current, see calc::evaluate
+    Awaiter eval_async(double & current, const std::string_view line) const { return {*this, current, line}; }
+
+private:
+    WorkerPool & m_pool;
+    const std::size_t m_inline_bytes;
+};
+
+} // namespace calc
@@ -0,0 +1,399 @@
+#pragma once
+
+// Header-only constexpr version of the calculator.
+//
+// calc::eval(current, line) has the same semantics as process_line, except
+// that no diagnostics are reported: a malformed or failing line leaves the
+// register unchanged. It can be evaluated at compile time:
+//
+//   constexpr double v = calc::eval(0.0, "(+) 1 2 3");
+//   constexpr double w = calc::fold<calc::Op::MUL>(1.0, 2.0, 3.0);
+//
+// At run time the standard math functions are used, so results are bitwise
+// identical to process_line. During constant evaluation SQRT and % are
+// computed exactly (they are correctly rounded by IEEE 754, so results are
+// identical too), while ^ is computed by binary exponentiation and is
+// limited to integral exponents. Every squaring doubles the relative error of
+// the power, so its result is only within about |exponent| ulps of std::pow
+// (more for subnormal results).
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+
+namespace calc {
+
+enum class Op
+{
+    ERR,
+    SET,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    REM,
+    NEG,
+    POW,
+    SQRT
+};
+
+constexpr std::size_t arity(const Op op)
+{
+    switch (op) {
+    case Op::ERR: return 0;
+    case Op::NEG: return 1;
+    case Op::SQRT: return 1;
+    case Op::SET: return 2;
+    case Op::ADD: return 2;
+    case Op::SUB: return 2;
+    case Op::MUL: return 2;
+    case Op::DIV: return 2;
+    case Op::REM: return 2;
+    case Op::POW: return 2;
+    }
+    return 0;
+}
+
+namespace detail {
+
+constexpr std::size_t max_decimal_digits = 10;
+constexpr double two52 = 4503599627370496.0;
+constexpr double two53 = 9007199254740992.0;
+
+constexpr bool is_constant_evaluated()
+{
+    return __builtin_is_constant_evaluated();
+}
+
+constexpr bool is_nan(const double x)
+{
+    return x != x;
+}
+
+constexpr bool is_inf(const double x)
+{
+    return x - x != 0 && !is_nan(x);
+}
+
+// std::isspace in the "C" locale
+constexpr bool is_space(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+constexpr char at(const std::string_view line, const std::size_t i)
+{
+    return i < line.size() ? line[i] : '\0';
+}
+
+// x * 2^e, exact as long as the result is representable
+constexpr double scale(double x, int e)
+{
+    for (; e > 0; --e) {
+        x *= 2;
+    }
+    for (; e < 0; ++e) {
+        x /= 2;
+    }
+    return x;
+}
+
+// Splits positive finite x into mantissa in [2^52, 2^53) and exponent
+constexpr std::uint64_t decompose(double x, int & e)
+{
+    e = 0;
+    for (; x >= two53; ++e) {
+        x /= 2;
+    }
+    for (; x < two52; --e) {
+        x *= 2;
+    }
+    return static_cast<std::uint64_t>(x);
+}
+
+// Correctly rounded square root of positive x
+constexpr double exact_sqrt(const double x)
+{
+    if (is_inf(x)) {
+        return x;
+    }
+    int e = 0;
+    std::uint64_t m = decompose(x, e);
+    if (e % 2 != 0) {
+        m <<= 1;
+        --e;
+    }
+    // Digit-by-digit square root of m * 2^56, giving a 55-bit root
+    const int extra_pairs = 28;
+    std::uint64_t root = 0;
+    std::uint64_t rem = 0;
+    for (int pair = 26 + extra_pairs; pair >= 0; --pair) {
+        const std::uint64_t bits = pair >= extra_pairs ? (m >> (2 * (pair - extra_pairs))) & 3 : 0;
+        rem = (rem << 2) | bits;
+        const std::uint64_t candidate = (root << 2) | 1;
+        root <<= 1;
+        if (rem >= candidate) {
+            rem -= candidate;
+            root |= 1;
+        }
+    }
+    // Round 55 bits to 53 to nearest even, with the remainder as a sticky bit
+    root |= rem != 0 ? 1 : 0;
+    std::uint64_t q = root >> 2;
+    const std::uint64_t dropped = root & 3;
+    if (dropped > 2 || (dropped == 2 && (q & 1) != 0)) {
+        ++q;
+    }
+    return scale(static_cast<double>(q), e / 2 - extra_pairs + 2);
+}
+
+// Exact floating-point remainder, right is non-zero
+constexpr double exact_fmod(const double left, const double right)
+{
+    if (is_nan(left) || is_nan(right) || is_inf(left)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    const double x = left < 0 ? -left : left;
+    const double y = right < 0 ? -right : right;
+    if (is_inf(y) || x < y) {
+        return left;
+    }
+    int ex = 0, ey = 0;
+    const std::uint64_t mx = decompose(x, ex);
+    const std::uint64_t my = decompose(y, ey);
+    std::uint64_t r = mx % my;
+    for (int k = ex - ey; k > 0; --k) {
+        r = (r << 1) % my;
+    }
+    const double res = scale(static_cast<double>(r), ey);
+    return left < 0 ? -res : res;
+}
+
+// Binary exponentiation, only integral exponents are supported. The relative
+// error grows to about |exponent| ulps: every squaring doubles it. Results
+// which overflow aren't constant expressions.
+constexpr double integral_pow(const double base, const double exponent)
+{
+    if (exponent == 0) {
+        return 1;
+    }
+    const double max_exponent = 4e18;
+    if (!(exponent > -max_exponent && exponent < max_exponent) || static_cast<double>(static_cast<std::int64_t>(exponent)) != exponent) {
+        throw std::domain_error("only integral exponents are supported at compile time");
+    }
+    const std::uint64_t n = static_cast<std::uint64_t>(exponent < 0 ? -exponent : exponent);
+    const auto power = [n](double b) {
+        double res = 1;
+        for (std::uint64_t k = n;; k >>= 1) {
+            if ((k & 1) != 0) {
+                res *= b;
+            }
+            // No squaring past the last bit, it could overflow needlessly
+            if (k == 1) {
+                return res;
+            }
+            b *= b;
+        }
+    };
+    if (exponent > 0) {
+        return power(base);
+    }
+    // A large base^n would overflow (which isn't a constant expression) where
+    // its reciprocal is tiny or subnormal, so such bases are inverted first
+    const double magnitude = base < 0 ? -base : base;
+    return magnitude >= 1 ? power(1 / base) : 1 / power(base);
+}
+
+constexpr double sqrt(const double x)
+{
+    return is_constant_evaluated() ? exact_sqrt(x) : std::sqrt(x);
+}
+
+constexpr double fmod(const double left, const double right)
+{
+    return is_constant_evaluated() ? exact_fmod(left, right) : std::fmod(left, right);
+}
+
+constexpr double pow(const double base, const double exponent)
+{
+    return is_constant_evaluated() ? integral_pow(base, exponent) : std::pow(base, exponent);
+}
+
+constexpr Op parse_op(const std::string_view line, std::size_t & i, bool & fold)
+{
+    // Returns ret if fold operation is correct, otherwise Op::ERR
+    const auto validate_fold = [&i, &line, &fold](const Op ret) {
+        if (fold && (i >= line.size() || line[i++] != ')')) {
+            return Op::ERR;
+        }
+        return ret;
+    };
+
+    if (at(line, i) == '(') {
+        fold = true;
+        i++;
+    }
+    const char c = at(line, i++);
+    if (c >= '0' && c <= '9') {
+        --i; // a first digit is a part of op's argument
+        return validate_fold(Op::SET);
+    }
+    switch (c) {
+    case '+': return validate_fold(Op::ADD);
+    case '-': return validate_fold(Op::SUB);
+    case '*': return validate_fold(Op::MUL);
+    case '/': return validate_fold(Op::DIV);
+    case '%': return validate_fold(Op::REM);
+    case '_': return validate_fold(Op::NEG);
+    case '^': return validate_fold(Op::POW);
+    case 'S':
+        if (at(line, i) == 'Q' && at(line, i + 1) == 'R' && at(line, i + 2) == 'T') {
+            i += 3;
+            return validate_fold(Op::SQRT);
+        }
+        return Op::ERR;
+    default: return Op::ERR;
+    }
+}
+
+constexpr std::size_t skip_ws(const std::string_view line, std::size_t i)
+{
+    while (i < line.size() && is_space(line[i])) {
+        ++i;
+    }
+    return i;
+}
+
+constexpr bool parse_arg(const std::string_view line, std::size_t & i, double & res, const bool fold)
+{
+    res = 0;
+    std::size_t count = 0;
+    bool integer = true;
+    double fraction = 1;
+    while (i < line.size() && count < max_decimal_digits) {
+        const char c = line[i];
+        if (c >= '0' && c <= '9') {
+            if (integer) {
+                res *= 10;
+                res += c - '0';
+            }
+            else {
+                fraction /= 10;
+                res += (c - '0') * fraction;
+            }
+            ++i;
+            ++count;
+        }
+        else if (c == '.') {
+            integer = false;
+            ++i;
+        }
+        else if (fold && is_space(c)) {
+            return true;
+        }
+        else {
+            return false;
+        }
+    }
+    return !(i < line.size() && count >= max_decimal_digits);
+}
+
+constexpr bool unary(const Op op, double & current)
+{
+    switch (op) {
+    case Op::NEG:
+        current = -current;
+        return true;
+    case Op::SQRT:
+        if (current > 0) {
+            current = sqrt(current);
+            return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+constexpr bool n_ary(const Op op, double & left, const double right)
+{
+    switch (op) {
+    case Op::SET: left = right; return true;
+    case Op::ADD: left = left + right; return true;
+    case Op::SUB: left = left - right; return true;
+    case Op::MUL: left = left * right; return true;
+    case Op::DIV:
+        if (right != 0) {
+            left = left / right;
+            return true;
+        }
+        return false;
+    case Op::REM:
+        if (right != 0) {
+            left = fmod(left, right);
+            return true;
+        }
+        return false;
+    case Op::POW: left = pow(left, right); return true;
+    default: return false;
+    }
+}
+
+} // namespace detail
+
+// Evaluates one line against the register, same as process_line
+constexpr double eval(const double current, const std::string_view line)
+{
+    std::size_t i = 0;
+    bool fold = false;
+    const auto op = detail::parse_op(line, i, fold);
+
+    switch (arity(op)) {
+    case 2: {
+        int arg_counter = 0;
+        double new_value = current;
+        do {
+            i = detail::skip_ws(line, i);
+            const auto old_i = i;
+            double arg = 0;
+            const bool success = detail::parse_arg(line, i, arg, fold);
+            if (i == old_i) {
+                if (fold && i >= line.size() && arg_counter >= 1) { // Trailing whitespaces are ok if there is at least 1 argument
+                    break;
+                }
+                return current;
+            }
+            if (!success || !detail::n_ary(op, new_value, arg)) {
+                return current;
+            }
+            arg_counter++;
+        } while (fold && i < line.size());
+        return new_value;
+    }
+    case 1: {
+        double new_value = current;
+        if (i < line.size() || !detail::unary(op, new_value)) {
+            return current;
+        }
+        return new_value;
+    }
+    default: return current;
+    }
+}
+
+// Left fold of the arguments by a binary operation, same as "(op) args..."
+template <Op op, class... Args>
+constexpr double fold(const double init, const Args... args)
+{
+    static_assert(arity(op) == 2 && op != Op::SET, "only binary operations can be folded");
+    static_assert(sizeof...(args) > 0, "at least one argument is required");
+    double res = init;
+    const auto apply = [&res](const double arg) { return detail::n_ary(op, res, arg); };
+    const bool success = (apply(args) && ...);
+    return success ? res : init;
+}
+
+} // namespace calc
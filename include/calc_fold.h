@@ -0,0 +1,108 @@
+#pragma once
+
+/* Stable C interface of the calculator, shipped as libcalc_fold.so.
+ * Lines are passed as (pointer, length) pairs and are never copied. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define CALC_API __attribute__((visibility("default")))
+#else
+#define CALC_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct calc_handle calc_handle;
+
+/* Error codes, values are part of the ABI */
+typedef enum calc_status
+{
+    CALC_OK = 0,
+    CALC_UNKNOWN_OPERATION = 1,
+    CALC_BAD_FOLD = 2,
+    CALC_BAD_ARGUMENT = 3,
+    CALC_ARGUMENT_TOO_LONG = 4,
+    CALC_MISSING_ARGUMENT = 5,
+    CALC_UNARY_SUFFIX = 6,
+    CALC_DIVISION_BY_ZERO = 7,
+    CALC_REMAINDER_BY_ZERO = 8,
+    CALC_BAD_SQRT = 9,
+    CALC_OPERATION_FAILED = 10,
+    CALC_LINE_TOO_LONG = 11,
+    CALC_TOO_MANY_ARGUMENTS = 12,
+    CALC_TIME_LIMIT_EXCEEDED = 13,
+    CALC_SESSION_EXHAUSTED = 14,
+    CALC_BAD_HANDLE = 100
+} calc_status;
+
+typedef struct calc_line
+{
+    const char * data;
+    size_t size;
+} calc_line;
+
+/* Resource limits, zero means unlimited. Line time is the thread CPU time
+ * of one line, session limits apply to all lines of the handle. */
+typedef struct calc_limits
+{
+    size_t max_line_bytes;
+    size_t max_arguments;
+    uint64_t max_line_time_ns;
+    uint64_t max_session_bytes;
+    uint64_t max_session_time_ns;
+} calc_limits;
+
+/* Admission control counters */
+typedef struct calc_admission
+{
+    uint64_t admitted;
+    uint64_t rejected_too_long;
+    uint64_t aborted_arguments;
+    uint64_t aborted_time;
+    uint64_t rejected_session;
+    uint64_t bytes;
+    uint64_t time_ns;
+} calc_admission;
+
+/* Creates a calculator with the given register value, NULL on failure */
+CALC_API calc_handle * calc_create(double initial);
+CALC_API void calc_destroy(calc_handle * handle);
+
+CALC_API double calc_value(const calc_handle * handle);
+CALC_API void calc_set_value(calc_handle * handle, double value);
+
+CALC_API void calc_set_limits(calc_handle * handle, const calc_limits * limits);
+CALC_API void calc_get_admission(const calc_handle * handle, calc_admission * admission);
+
+/* Applies one line to the register. No diagnostics are printed. */
+CALC_API calc_status calc_eval(calc_handle * handle, const char * line, size_t size);
+
+/* Applies count lines in order. The register value after each line is
+ * stored to results[i] and its status to statuses[i]; either array may be
+ * NULL. Returns the number of lines which failed. */
+CALC_API size_t calc_eval_batch(calc_handle * handle, const calc_line * lines, size_t count, double * results, calc_status * statuses);
+
+/* Same for lines separated by '\n' in one buffer, a trailing newline is
+ * optional. Up to capacity lines are evaluated; the number of evaluated
+ * lines is stored to *evaluated. Returns the number of failed lines. */
+CALC_API size_t calc_eval_text(calc_handle * handle, const char * text, size_t size, double * results, calc_status * statuses, size_t capacity, size_t * evaluated);
+
+/* Applies lines[i] to registers[i] for count independent registers, without
+ * a handle and its limits. Requests with the same operation are evaluated
+ * together. statuses may be NULL. Returns the number of failed requests. */
+CALC_API size_t calc_eval_independent(double * registers, const calc_line * lines, size_t count, calc_status * statuses);
+
+/* SQRT and NEG over count registers in place. Registers which aren't
+ * positive are left unchanged by SQRT and marked in errors: bit i % 64 of
+ * errors[i / 64], (count + 63) / 64 words, may be NULL. Returns the number
+ * of marked registers. */
+CALC_API size_t calc_sqrt_batch(double * registers, size_t count, uint64_t * errors);
+CALC_API void calc_neg_batch(double * registers, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
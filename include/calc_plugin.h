@@ -0,0 +1,60 @@
+#pragma once
+
+/* Operator plugins.
+ *
+ * A plugin is a shared object exporting
+ *
+ *     int calc_fold_plugin_init(calc_register_operator_fn register_operator);
+ *
+ * which registers its operators and returns 0 on success. Plugin operators
+ * are looked up after the built-in ones, so they can't redefine them. */
+
+#include "calc_fold.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Applies the operator: *left = *left op right (right is 0 for unary
+ * operators). Returns 0 on success, otherwise the register is left intact. */
+typedef int (*calc_scalar_kernel)(double * left, double right);
+
+/* Optional kernel applying a whole fold: *acc = ((*acc op args[0]) op ...).
+ * Returns 0 on success. */
+typedef int (*calc_fold_kernel)(double * acc, const double * args, size_t count);
+
+typedef struct calc_operator
+{
+    /* Printable characters without spaces, not starting with a digit or a
+     * bracket, e.g. "CLAMP" */
+    const char * spelling;
+    /* 1 or 2 */
+    unsigned arity;
+    calc_scalar_kernel scalar;
+    calc_fold_kernel fold;
+    /* Fold properties, reserved: the engine doesn't use them yet */
+    int associative;
+    int has_identity;
+    double identity;
+} calc_operator;
+
+typedef int (*calc_register_operator_fn)(const calc_operator * op);
+
+/* Registration statuses */
+#define CALC_PLUGIN_OK 0
+#define CALC_PLUGIN_BAD_OPERATOR 1
+#define CALC_PLUGIN_DUPLICATE 2
+#define CALC_PLUGIN_TABLE_FULL 3
+#define CALC_PLUGIN_LOAD_FAILED 4
+
+/* Adds an operator to the global table, the description is copied */
+CALC_API int calc_register_operator(const calc_operator * op);
+
+/* Loads a plugin with dlopen and runs its calc_fold_plugin_init */
+CALC_API int calc_load_plugin(const char * path);
+
+#ifdef __cplusplus
+}
+#endif
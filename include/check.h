@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string_view>
+
+// Validates every line of text with check_line, splitting the text into
+// chunks which are checked concurrently by up to `threads` workers.
+// Diagnostics are written to err in line order, each prefixed with
+// "<name>:<line number>: ". Returns the number of malformed lines.
+std::size_t check_text(std::string_view text, std::string_view name, unsigned threads, std::ostream & err);
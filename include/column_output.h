@@ -0,0 +1,85 @@
+#pragma once
+
+#include "calc.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Writes per-line results as a binary column file instead of text.
+//
+// The file starts with a ColumnFileHeader and continues with record batches.
+// A batch is a ColumnBatchHeader followed by its columns in this order:
+//   line      uint64  1-based input line number, lines with several
+//                     operations (--sequences) have a row for each
+//   result    float64 register value after the line
+//   arguments uint32  fold length (see calc::LineInfo::arguments)
+//   op        uint16  operation code (see calc::LineInfo::op)
+//   status    uint16  calc::Status, equal to calc_status of the C interface
+// Every header and column starts at a multiple of column_alignment bytes
+// from the start of the file, the gaps are zero. Numbers are in the byte
+// order of the writer, recorded in the file header. The file ends with a
+// batch of zero rows, a file without it was not completely written.
+struct ColumnFileHeader
+{
+    char magic[8];             // "CALCCOL\0"
+    std::uint32_t version;     // 1
+    std::uint32_t byte_order;  // 0x01020304 as written by the host
+    std::uint32_t columns;     // 5
+    std::uint32_t batch_rows;  // maximum rows in a batch
+    std::uint32_t alignment;   // column_alignment
+    char reserved[36];
+};
+
+struct ColumnBatchHeader
+{
+    std::uint64_t rows;
+    // Line number of the first row, 0 in the end marker
+    std::uint64_t first_line;
+    char reserved[48];
+};
+
+const std::size_t column_alignment = 64;
+
+static_assert(sizeof(ColumnFileHeader) == column_alignment, "file header is one alignment unit");
+static_assert(sizeof(ColumnBatchHeader) == column_alignment, "batch header is one alignment unit");
+
+class ColumnOutput
+{
+public:
+    static const std::size_t default_batch_rows = 1 << 16;
+
+    explicit ColumnOutput(int fd, std::size_t batch_rows = default_batch_rows);
+    ColumnOutput(const ColumnOutput &) = delete;
+    ColumnOutput & operator=(const ColumnOutput &) = delete;
+
+    // Appends a row, line numbers must not decrease
+    void put(const std::uint64_t line, const double result, const calc::Status status, const calc::LineInfo & info)
+    {
+        m_line[m_rows] = line;
+        m_result[m_rows] = result;
+        m_arguments[m_rows] = static_cast<std::uint32_t>(info.arguments);
+        m_op[m_rows] = static_cast<std::uint16_t>(info.op);
+        m_status[m_rows] = static_cast<std::uint16_t>(status);
+        if (++m_rows == m_batch_rows) {
+            write_batch();
+        }
+    }
+
+    // Writes the last batch and the end marker. Returns false if anything
+    // failed, further output is discarded.
+    bool finish();
+
+private:
+    void write_batch();
+
+    int m_fd;
+    std::size_t m_batch_rows;
+    std::size_t m_rows = 0;
+    std::unique_ptr<std::uint64_t[]> m_line;
+    std::unique_ptr<double[]> m_result;
+    std::unique_ptr<std::uint32_t[]> m_arguments;
+    std::unique_ptr<std::uint16_t[]> m_op;
+    std::unique_ptr<std::uint16_t[]> m_status;
+    bool m_failed = false;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Order-sensitive non-cryptographic digest of a sequence of results.
+// Every value is hashed by its bit pattern with an XXH64-style round, so
+// the digest is only equal for bitwise identical sequences.
+class Digest
+{
+public:
+    void update(double value);
+
+    std::uint64_t lines() const { return m_lines; }
+    // Digest of all values seen so far
+    std::uint64_t value() const;
+    // "<16 hex digits> <lines>"
+    std::string str() const;
+
+private:
+    std::uint64_t m_acc = 0x27D4EB2F165667C5ULL;
+    std::uint64_t m_lines = 0;
+};
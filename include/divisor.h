@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+namespace calc {
+
+// Division and remainder by one divisor which is applied to many dividends.
+// Everything the constructor can precompute is precomputed, and the results
+// are bitwise identical to x / d and std::fmod(x, d):
+//  - a power of two is divided by as a multiplication by its exact
+//    reciprocal, which rounds the same real value;
+//  - other divisors use the division instruction: a reciprocal with an FMA
+//    correction step is exact as well, but it was slower than packed
+//    division both for one value and over arrays;
+//  - remainders of integers below 2^52 by an integer are computed exactly
+//    from the reciprocal with one correction, of other finite values by a
+//    power of two from the exact quotient, anything else calls std::fmod.
+// The divisor must not be zero.
+class Divisor
+{
+public:
+    explicit Divisor(double divisor);
+
+    double value() const { return m_divisor; }
+
+    double divide(const double x) const
+    {
+        return m_power_of_two ? x * m_reciprocal : x / m_divisor;
+    }
+
+    double remainder(const double x) const
+    {
+        return m_integral || m_power_of_two ? fast_remainder(x) : std::fmod(x, m_divisor);
+    }
+
+    // In place over arrays
+    void divide(double * x, std::size_t count) const;
+    void remainder(double * x, std::size_t count) const;
+
+private:
+    double fast_remainder(double x) const;
+
+    double m_divisor;
+    double m_reciprocal;
+    double m_magnitude;
+    bool m_power_of_two = false;
+    // The divisor is an integer of magnitude below 2^52
+    bool m_integral = false;
+};
+
+} // namespace calc
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "session.h"
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+// Aggregated diagnostics for inputs with many malformed lines. Errors are
+// grouped into categories by their status: the diagnostics of the first
+// `examples` failing lines of every category are printed in full, the rest
+// are only counted. Every `summary_every` lines (0 - never) a summary of the
+// errors so far is printed if there were new ones, and finish() prints a
+// final report.
+//
+// The engine asks the report (as the DiagnosticFilter of its diagnostics
+// stream) before formatting a diagnostic, so only the printed ones are ever
+// formatted, and every line is evaluated once.
+class ErrorReport : private calc::DiagnosticFilter
+{
+public:
+    ErrorReport(std::ostream & err, std::uint64_t examples, std::uint64_t summary_every = 0);
+
+    // Like the same methods of Session, with diagnostics going through the report
+    calc::Status eval(calc::Session & session, std::string_view line);
+    calc::Status eval(calc::Session & session, std::string_view line, calc::LineInfo & info);
+    calc::Status reject_too_long(calc::Session & session, std::size_t bytes);
+
+    // Failing lines of a category so far
+    std::uint64_t count(calc::Status status) const { return m_counts[static_cast<std::size_t>(status)]; }
+    std::uint64_t errors() const { return m_errors; }
+
+    // Prints the final report, nothing if there were no errors
+    void finish();
+
+private:
+    static const std::size_t categories = static_cast<std::size_t>(calc::Status::SessionExhausted) + 1;
+
+    // Counts a failing line
+    void record(calc::Status status);
+    // Prints a periodic summary when it is due
+    void after_line();
+    void summary(const char * title);
+    // Whether a failure of this status still makes an example
+    bool wants(calc::Status status) const override;
+
+    std::ostream & m_err;
+    std::uint64_t m_examples;
+    std::uint64_t m_summary_every;
+    std::uint64_t m_lines = 0;
+    std::uint64_t m_errors = 0;
+    std::uint64_t m_summarized = 0;
+    std::array<std::uint64_t, categories> m_counts{};
+    // Writes to the buffer of m_err, filtered by wants()
+    std::ostream m_sink;
+};
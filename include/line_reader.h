@@ -0,0 +1,56 @@
+#pragma once
+
+#include "arena.h"
+
+#include <cstddef>
+#include <string_view>
+
+// Reads lines from a file descriptor in batches. Every batch lives in an
+// arena which is reset two batches later, so lines of a batch stay valid
+// until the next call of next(), and no memory is allocated in steady state.
+class LineReader
+{
+public:
+    struct Line
+    {
+        std::string_view text;
+        // Size of a line longer than the limit, which was skipped without
+        // being stored (its text is empty), 0 otherwise
+        std::size_t skipped;
+    };
+
+    struct Batch
+    {
+        const Line * lines = nullptr;
+        std::size_t size = 0;
+    };
+
+    static const std::size_t default_block_size = 1 << 16;
+
+    // max_line_bytes == 0 means unlimited
+    explicit LineReader(int fd, std::size_t max_line_bytes = 0, std::size_t block_size = default_block_size);
+
+    // Reads the next portion of input, which may contain no complete lines.
+    // Returns false at the end of input, or after a read error.
+    bool next(Batch & batch);
+
+    // errno of the read which failed, 0 if the input ended normally
+    int error() const { return m_error; }
+
+    // Peak memory of the batch arenas
+    std::size_t peak() const;
+
+private:
+    Arena m_arenas[2];
+    std::size_t m_current = 0;
+    int m_fd;
+    std::size_t m_max_line_bytes;
+    std::size_t m_block_size;
+    // Incomplete last line of the previous batch
+    std::string_view m_carry;
+    // Bytes of the oversized line being skipped, if any
+    std::size_t m_skipped = 0;
+    bool m_skipping = false;
+    bool m_eof = false;
+    int m_error = 0;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Writes register values to a file through shared mappings, formatting them
+// on several threads. Values are collected and every `window` of them is
+// split into one range per thread; the threads format their ranges into
+// scratch buffers, then copy them at their offsets into the file, which is
+// preallocated ahead with fallocate and truncated to its size on close().
+class MappedOutput
+{
+public:
+    static const std::size_t default_window = 1 << 20;
+
+    MappedOutput(const std::string & path, unsigned threads, std::size_t window = default_window);
+    MappedOutput(const MappedOutput &) = delete;
+    MappedOutput & operator=(const MappedOutput &) = delete;
+    ~MappedOutput();
+
+    // False if the file can't be created
+    bool is_open() const { return m_fd >= 0; }
+
+    void put(const double value)
+    {
+        m_values.push_back(value);
+        if (m_values.size() == m_window) {
+            drain();
+        }
+    }
+
+    // Writes the remaining values and truncates the file. Returns false if
+    // anything failed since the file was opened.
+    bool close();
+
+private:
+    void drain();
+
+    int m_fd;
+    unsigned m_threads;
+    std::size_t m_window;
+    std::vector<double> m_values;
+    // Formatted text of every thread's range
+    std::vector<std::unique_ptr<char[]>> m_scratch;
+    std::vector<std::size_t> m_sizes;
+    std::size_t m_scratch_size;
+    // Bytes written and bytes preallocated in the file
+    std::uint64_t m_size = 0;
+    std::uint64_t m_allocated = 0;
+    bool m_failed = false;
+};
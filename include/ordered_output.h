@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <semaphore.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Stitches outputs of segments produced in parallel into one file descriptor
+// in sequence order. Producers begin segment n (waiting until n is within
+// `window` segments of the oldest unwritten one), append data to it and end
+// it; a single writer thread emits every contiguous run of ready data with
+// writev. A segment holding more than segment_bytes unwritten bytes makes
+// its producer wait for the writer, so memory stays bounded by about
+// window * segment_bytes however fast the producers are.
+//
+// Every sequence number from 0 up must be begun and ended exactly once.
+class OrderedOutput
+{
+public:
+    static const std::size_t default_segment_bytes = 1 << 20;
+
+    OrderedOutput(int fd, std::size_t window, std::size_t segment_bytes = default_segment_bytes);
+    OrderedOutput(const OrderedOutput &) = delete;
+    OrderedOutput & operator=(const OrderedOutput &) = delete;
+    ~OrderedOutput();
+
+    void begin(std::uint64_t sequence);
+    void write(std::uint64_t sequence, std::string data);
+    void end(std::uint64_t sequence);
+
+    // Waits until all ended segments are written and stops the writer.
+    // Returns false if writing failed (the rest of the output is dropped).
+    bool finish();
+
+private:
+    static const std::uint64_t none = static_cast<std::uint64_t>(-1);
+
+    struct Slot
+    {
+        std::uint64_t sequence = none;
+        std::vector<std::string> pieces;
+        std::size_t bytes = 0;
+        bool done = false;
+        // The producer waits on space until the writer takes the pieces
+        bool waiting = false;
+        sem_t space;
+    };
+
+    // Producer waiting in begin() for its segment to enter the window
+    struct Waiter
+    {
+        std::uint64_t sequence;
+        sem_t * wake;
+    };
+
+    Slot & slot(const std::uint64_t sequence) { return m_slots[sequence % m_slots.size()]; }
+    void work();
+    bool write_all(std::vector<std::string> & pieces);
+
+    int m_fd;
+    std::size_t m_segment_bytes;
+    std::vector<Slot> m_slots;
+    std::vector<Waiter> m_waiters;
+    std::mutex m_mutex;
+    // Posted on every change the writer may be interested in
+    sem_t m_ready;
+    // Oldest segment not completely written
+    std::uint64_t m_head = 0;
+    bool m_finishing = false;
+    bool m_failed = false;
+    std::thread m_writer;
+};
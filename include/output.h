@@ -0,0 +1,96 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+struct iovec;
+
+// Longest formatted value including the newline
+const std::size_t max_value_length = 32;
+
+// Formats a register value followed by a newline like std::ostream with
+// default flags does, out must have room for max_value_length characters
+inline char * format_value(char * out, const double value)
+{
+    out = std::to_chars(out, out + max_value_length, value, std::chars_format::general, 6).ptr;
+    *out++ = '\n';
+    return out;
+}
+
+// Same for registers of the single precision engine, the text is the same
+// as for the value converted to double
+inline char * format_value(char * out, const float value)
+{
+    out = std::to_chars(out, out + max_value_length, value, std::chars_format::general, 6).ptr;
+    *out++ = '\n';
+    return out;
+}
+
+// Writes all count buffers to fd with writev(2), at most IOV_MAX at a time,
+// resuming partial writes from the first unwritten byte and retrying
+// interrupted ones. iov is consumed. Returns false on an error.
+bool write_fully(int fd, iovec * iov, std::size_t count);
+
+// Formats register values (like std::ostream with default flags) into a ring
+// of page-aligned memory and writes them to a file descriptor on flush().
+//
+// With allow_splice set and the descriptor being a pipe the pages are handed
+// to it with vmsplice(2) instead of being copied by write(2). The pipe then refers to the pages
+// until the reader consumes them, so a page is only reused after more pages
+// than the pipe can hold have been spliced after it: the ring is twice the
+// pipe capacity and every flush continues from the next page boundary.
+// This assumes the reader copies the data out (read(2)); a reader which
+// splices the pages further would see them change, use write mode for it.
+// Anything other than a pipe, or a kernel without vmsplice, uses write(2).
+class Output
+{
+public:
+    explicit Output(int fd, bool allow_splice = false);
+    Output(const Output &) = delete;
+    Output & operator=(const Output &) = delete;
+    ~Output();
+
+    void put(const double value)
+    {
+        if (static_cast<std::size_t>(m_end - m_pos) < max_value_length) {
+            make_room();
+        }
+        m_pos = format_value(m_pos, value);
+    }
+
+    void put(const float value)
+    {
+        if (static_cast<std::size_t>(m_end - m_pos) < max_value_length) {
+            make_room();
+        }
+        m_pos = format_value(m_pos, value);
+    }
+
+    void write(std::string_view text);
+
+    // Returns false if the output failed, further output is discarded
+    bool flush();
+
+    bool splicing() const { return m_splice; }
+    // Bytes handed to the descriptor so far
+    std::uint64_t bytes() const { return m_bytes; }
+
+private:
+    void make_room();
+    bool write_out(const char * data, std::size_t size);
+    bool splice_out(char * data, std::size_t size);
+
+    int m_fd;
+    bool m_splice = false;
+    bool m_failed = false;
+    std::size_t m_page_size;
+    std::size_t m_capacity;
+    char * m_ring;
+    char * m_end;
+    // Formatted but not yet flushed data is [m_flushed, m_pos)
+    char * m_flushed;
+    char * m_pos;
+    std::uint64_t m_bytes = 0;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "topology.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Runs body(i) for every i in [0, count) on up to `threads` threads, the
+// calling one included. Every thread starts with an equal contiguous range of
+// indices; a thread which runs out of work steals the upper half of the
+// largest range left to another thread, so uneven jobs keep all threads busy.
+//
+// On a machine with several NUMA nodes the threads are pinned to the nodes of
+// the topology in contiguous blocks, so the ranges of neighbouring indices
+// run on one node, and a thread steals from the threads of its own node
+// before it turns to other nodes. Memory first written by body(i) is then
+// placed on the node of the thread which will usually run i again.
+void parallel_for(std::size_t count, unsigned threads, const std::function<void(std::size_t)> & body);
+void parallel_for(std::size_t count, unsigned threads, const std::function<void(std::size_t)> & body, const Topology & topology);
+
+// Same, but indices are started strictly in ascending order by whichever
+// thread is free, for jobs whose results are consumed in order (see
+// OrderedOutput) and which would otherwise wait for far-behind indices
+void parallel_for_ordered(std::size_t count, unsigned threads, const std::function<void(std::size_t)> & body);
+
+// Runs body(worker) for every worker on its own thread (worker 0 on the
+// calling one), pinned to the node nodes[worker] of topology if it has more
+// than one node. The calling thread gets its affinity back afterwards.
+void run_on_nodes(const std::vector<std::size_t> & nodes, const Topology & topology, const std::function<void(std::size_t)> & body);
+
+// Reduces [0, count) on up to `threads` threads placed like those of
+// parallel_for: every thread reduces an equal contiguous range with
+// map(begin, end), then the partial results are combined on their node and
+// the results of the nodes on the calling thread. Partial results are always
+// combined in the order of their ranges, but their grouping follows the
+// nodes of the topology, so for a non-associative combine the result depends
+// on the number of threads and the NUMA layout (for an associative one, on
+// nothing). T must be default constructible; no indices give init.
+template <class T, class Map, class Combine>
+T parallel_reduce(const std::size_t count, const unsigned threads, T init, Map && map, Combine && combine, const Topology & topology = Topology::system())
+{
+    if (count == 0) {
+        return init;
+    }
+    const std::size_t n = std::max<std::size_t>(1, std::min<std::size_t>(threads, count));
+    std::vector<std::size_t> worker_nodes(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        worker_nodes[i] = topology.node_of(i, n);
+    }
+    std::vector<T> partials(n);
+    run_on_nodes(worker_nodes, topology, [&](const std::size_t i) { partials[i] = map(count * i / n, count * (i + 1) / n); });
+
+    // Workers of a node are consecutive: [first[k], first[k + 1])
+    std::vector<std::size_t> nodes, first;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i == 0 || worker_nodes[i] != worker_nodes[i - 1]) {
+            nodes.push_back(worker_nodes[i]);
+            first.push_back(i);
+        }
+    }
+    first.push_back(n);
+    std::vector<T> sums(nodes.size());
+    const auto combine_node = [&](const std::size_t k) {
+        T sum = std::move(partials[first[k]]);
+        for (std::size_t i = first[k] + 1; i < first[k + 1]; ++i) {
+            sum = combine(std::move(sum), std::move(partials[i]));
+        }
+        sums[k] = std::move(sum);
+    };
+    if (nodes.size() > 1) {
+        run_on_nodes(nodes, topology, combine_node);
+    }
+    else {
+        combine_node(0);
+    }
+    for (auto & sum : sums) {
+        init = combine(std::move(init), std::move(sum));
+    }
+    return init;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "session.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace calc {
+
+// Script statements on top of plain lines:
+//   def name { body }   defines a subroutine, the body may span lines
+//   call name [xN]      runs a subroutine N times (once by default)
+//   repeat N { body }   runs a body N times, at the top level or in a body
+// A body holds operations and calls separated by ';' or line breaks. It is
+// parsed once when it is defined, malformed bodies are reported then; calls
+// apply the decoded operations without looking at their text again. The
+// operations of a body behave like separate lines: a failing one leaves the
+// register unchanged and the following ones still run. A body may hold at
+// most LineLimits::max_arguments arguments of the session, and calls and
+// loops nest at most max_nesting levels deep.
+//
+// A statement is admitted by the session like a line of its text: it is
+// rejected once the session budgets are used up, and its calls and loops
+// stop with TimeLimitExceeded, leaving the register unchanged, when the
+// statement outlives the time limit of a line or the session time budget.
+//
+// With affine set, runs of operations which are affine maps of the register
+// (SET, + - * / by constants, _, calls of such subroutines) are pre-composed
+// into one a * x + b, and N calls of an affine subroutine are composed in
+// O(log N), as are N runs of a repeat with an affine body. This rounds
+// differently from applying them one by one. Compositions which would change
+// more than the rounding are not made and their steps run one by one: those
+// whose coefficients overflow (inf * 0 gives NaN) or whose a underflows to
+// zero or a subnormal from nonzero factors (an infinite register would give
+// NaN, a huge one 0); SET is tracked apart from * 0. Without affine set loops
+// iterate and results stay exactly those of the separate lines.
+class Script
+{
+public:
+    enum class Line
+    {
+        Plain,     // not a script statement, evaluate it as usual
+        Consumed,  // (part of) a definition, nothing to print
+        Evaluated, // a statement was run, print the register
+    };
+
+    static const std::size_t max_nesting = 64;
+
+    explicit Script(bool affine = false);
+
+    Line feed(Session & session, std::string_view line, std::ostream & err);
+
+    // Ends the input: reports a statement left without its closing brace,
+    // returns false if there was one
+    bool finish(std::ostream & err);
+
+    bool defined(const std::string & name) const { return m_names.count(name) != 0; }
+
+private:
+    // x -> a * x + b, or x -> b regardless of x for a map containing a SET
+    struct Affine
+    {
+        double a = 1;
+        double b = 0;
+        bool constant = false;
+    };
+
+    struct Step
+    {
+        enum class Kind
+        {
+            Operation,
+            Affine,
+            Call,
+        };
+        explicit Step(const Kind kind)
+            : kind(kind)
+        {
+        }
+
+        Kind kind;
+        // Operation: code as in LineInfo::op and the arguments in Block::args
+        unsigned op = 0;
+        bool fold = false;
+        std::size_t first = 0;
+        std::size_t count = 0;
+        // Affine: the map applied to the register
+        Affine map;
+        // Call: index of the block and the number of runs
+        std::size_t block = 0;
+        std::uint64_t times = 1;
+    };
+
+    struct Block
+    {
+        std::vector<Step> steps;
+        std::vector<double> args;
+        // All steps compose into a single affine step (affine mode only)
+        bool affine = false;
+        Affine map;
+        // Levels of calls and loops below the block
+        std::size_t depth = 0;
+    };
+
+    // Time left to a running statement
+    struct Budget
+    {
+        bool timed = false;
+        std::chrono::nanoseconds deadline{0};
+        std::uint64_t runs = 0;
+    };
+
+    void define(std::string_view text, const LineLimits & limits, std::ostream & err);
+    // Compiles statements up to the closing brace of a body (at level 0, the
+    // top level, up to the end of text)
+    bool compile(std::string_view text, std::size_t & pos, Block & block, const LineLimits & limits, std::size_t level, std::ostream & err);
+    void compose(Block & block) const;
+    Status run(const Block & block, double & current, Budget & budget, std::ostream & err) const;
+
+    bool m_affine;
+    // Subroutines and loop bodies
+    std::vector<Block> m_blocks;
+    std::unordered_map<std::string, std::size_t> m_names;
+    // Unfinished statement and its brace depth
+    std::string m_pending;
+    long m_depth = 0;
+};
+
+} // namespace calc
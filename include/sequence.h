@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cctype>
+#include <string_view>
+
+namespace calc {
+
+// Separates operations of a line
+const char operation_separator = ';';
+
+// Calls f for every operation of a line "op [arg]; op [arg]; ...", trimmed of
+// the whitespace around it; empty operations are skipped. A line without
+// separators is passed as is, so it is evaluated exactly like before.
+template <class F>
+void for_each_operation(const std::string_view line, F && f)
+{
+    std::size_t end = line.find(operation_separator);
+    if (end == std::string_view::npos) {
+        f(line);
+        return;
+    }
+    for (std::size_t begin = 0; begin <= line.size(); end = line.find(operation_separator, begin)) {
+        end = end == std::string_view::npos ? line.size() : end;
+        std::size_t first = begin, last = end;
+        while (first < last && std::isspace(static_cast<unsigned char>(line[first]))) {
+            ++first;
+        }
+        while (last > first && std::isspace(static_cast<unsigned char>(line[last - 1]))) {
+            --last;
+        }
+        if (first != last) {
+            f(line.substr(first, last - first));
+        }
+        begin = end + 1;
+    }
+}
+
+} // namespace calc
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "calc.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+
+namespace calc {
+
+struct Limits
+{
+    LineLimits line;
+    // Session-wide budgets, zero means unlimited
+    std::uint64_t max_bytes = 0;
+    std::chrono::nanoseconds max_time{0};
+};
+
+// Admission control counters
+struct Admission
+{
+    std::uint64_t admitted = 0;
+    std::uint64_t rejected_too_long = 0;
+    std::uint64_t aborted_arguments = 0;
+    std::uint64_t aborted_time = 0;
+    std::uint64_t rejected_session = 0;
+    // Bytes of admitted lines
+    std::uint64_t bytes = 0;
+    // CPU time of admitted lines, only measured if a time limit is set
+    std::chrono::nanoseconds time{0};
+};
+
+// A register together with the resource limits of its owner
+class Session
+{
+public:
+    explicit Session(const Limits & limits = {}, double initial = 0);
+
+    double value() const { return m_current; }
+    void set_value(const double value) { m_current = value; }
+
+    // Evaluates with a float register (see the float overloads of evaluate),
+    // value() then always holds a float value
+    bool single_precision() const { return m_single; }
+    void set_single_precision(const bool single)
+    {
+        m_single = single;
+        m_current = single ? static_cast<float>(m_current) : m_current;
+    }
+
+    const Limits & limits() const { return m_limits; }
+    void set_limits(const Limits & limits) { m_limits = limits; }
+
+    const Admission & admission() const { return m_admission; }
+
+    Status eval(std::string_view line, std::ostream & err);
+    // Same, also describing the line in info
+    Status eval(std::string_view line, std::ostream & err, LineInfo & info);
+    // Same, without diagnostics
+    Status eval(std::string_view line);
+    // Rejects an oversized line which the caller has skipped without reading
+    Status reject_too_long(std::size_t bytes, std::ostream & err);
+
+    // Whether the session budgets are used up, lines are rejected then
+    bool exhausted() const;
+    // Time a line may take: the tighter of the line limit and what is left
+    // of the session budget, zero means unlimited
+    std::chrono::nanoseconds time_allowed() const;
+    // Admits a statement evaluated by the caller (scripts) like a line of
+    // bytes which took time
+    Status admit(Status status, std::size_t bytes, std::chrono::nanoseconds time);
+
+private:
+    Status run(std::string_view line, std::ostream & err, LineInfo * info);
+    Status count(Status status);
+
+    Limits m_limits;
+    Admission m_admission;
+    double m_current;
+    bool m_single = false;
+};
+
+} // namespace calc
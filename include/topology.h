@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// NUMA nodes as the sets of CPUs the process may run on. Parallel loops
+// spread their workers over the nodes in contiguous blocks, so neighbouring
+// indices (and the buffers written by them) stay on one node.
+class Topology
+{
+public:
+    // Nodes with the given CPUs, nodes without CPUs are dropped
+    explicit Topology(std::vector<std::vector<int>> nodes);
+
+    // Nodes of this machine (/sys/devices/system/node) restricted to the
+    // affinity mask of the process; a single node with the allowed CPUs if
+    // there is no NUMA information. Read once.
+    static const Topology & system();
+
+    // Parses a kernel CPU list like "0-3,8,10-11", invalid text gives an empty list
+    static std::vector<int> parse_cpulist(std::string_view text);
+
+    std::size_t nodes() const { return m_nodes.size(); }
+    const std::vector<int> & cpus(const std::size_t node) const { return m_nodes[node]; }
+
+    // Node of a worker out of workers: consecutive workers share a node
+    std::size_t node_of(const std::size_t worker, const std::size_t workers) const { return worker * nodes() / workers; }
+
+    // Restricts the calling thread to the CPUs of a node, false if that fails
+    bool pin(std::size_t node) const;
+
+private:
+    std::vector<std::vector<int>> m_nodes;
+};
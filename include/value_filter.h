@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Selects which register values are printed, so that values dropped by it
+// are never formatted or written:
+//   All       - every value
+//   Final     - only the last one, given by last() once the input ends
+//   Every     - every Nth value (the Nth, 2Nth, ...)
+//   Changes   - values whose bit pattern differs from the previous value
+//   Crossing  - values on the other side of a threshold than the previous
+//               value (a value equal to the threshold is above it)
+// The previous value of the first one is the initial register value.
+class ValueFilter
+{
+public:
+    enum class Mode
+    {
+        All,
+        Final,
+        Every,
+        Changes,
+        Crossing,
+    };
+
+    ValueFilter() = default;
+    // parameter is N for Every and the threshold for Crossing
+    ValueFilter(const Mode mode, const double parameter, const double initial)
+        : m_mode(mode)
+        , m_every(mode == Mode::Every ? static_cast<std::uint64_t>(parameter) : 0)
+        , m_threshold(parameter)
+        , m_previous(initial)
+    {
+    }
+
+    Mode mode() const { return m_mode; }
+
+    // Whether value is printed right away
+    bool keep(const double value)
+    {
+        ++m_seen;
+        switch (m_mode) {
+        case Mode::All:
+            return true;
+        case Mode::Final:
+            m_previous = value;
+            return false;
+        case Mode::Every:
+            return m_every != 0 && m_seen % m_every == 0;
+        case Mode::Changes: {
+            std::uint64_t bits, previous_bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            std::memcpy(&previous_bits, &m_previous, sizeof(previous_bits));
+            m_previous = value;
+            return bits != previous_bits;
+        }
+        case Mode::Crossing: {
+            const bool crossed = (value >= m_threshold) != (m_previous >= m_threshold);
+            m_previous = value;
+            return crossed;
+        }
+        }
+        return true;
+    }
+
+    // Whether a last value is printed at the end of the input (Final mode
+    // after at least one value), the value is stored in value
+    bool last(double & value) const
+    {
+        value = m_previous;
+        return m_mode == Mode::Final && m_seen != 0;
+    }
+
+private:
+    Mode m_mode = Mode::All;
+    std::uint64_t m_every = 0;
+    double m_threshold = 0;
+    double m_previous = 0;
+    // Values passed to keep() so far
+    std::uint64_t m_seen = 0;
+};
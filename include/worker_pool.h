@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <semaphore.h>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads running submitted tasks in FIFO order. Tasks are
+// intrusive: the caller owns them and keeps them alive until they have run,
+// so submitting never allocates.
+class WorkerPool
+{
+public:
+    struct Task
+    {
+        void (*run)(Task & task) = nullptr;
+        Task * next = nullptr;
+    };
+
+    // Zero means one thread per hardware thread
+    explicit WorkerPool(unsigned threads = 0);
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool & operator=(const WorkerPool &) = delete;
+    // Runs the tasks still queued, then joins the threads
+    ~WorkerPool();
+
+    void submit(Task & task);
+
+    std::size_t size() const { return m_threads.size(); }
+
+private:
+    void work();
+
+    std::mutex m_mutex;
+    // Counts queued tasks plus one wake-up per thread on shutdown
+    sem_t m_ready;
+    Task * m_head = nullptr;
+    Task * m_tail = nullptr;
+    std::vector<std::thread> m_threads;
+};
@@ -0,0 +1,47 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+Arena::Arena(const std::size_t chunk_size)
+    : m_chunk_size(chunk_size)
+{
+}
+
+void * Arena::allocate(const std::size_t size, const std::size_t alignment)
+{
+    for (;;) {
+        if (m_chunk < m_chunks.size()) {
+            auto & chunk = m_chunks[m_chunk];
+            const auto address = reinterpret_cast<std::uintptr_t>(chunk.data.get()) + m_offset;
+            const std::size_t padding = (alignment - address % alignment) % alignment;
+            if (m_offset + padding + size <= chunk.size) {
+                void * res = chunk.data.get() + m_offset + padding;
+                m_offset += padding + size;
+                m_peak = std::max(m_peak, used());
+                return res;
+            }
+            // Doesn't fit: the rest of the chunk stays unused until rewind
+            m_base += chunk.size;
+            m_offset = 0;
+            ++m_chunk;
+            continue;
+        }
+        const std::size_t chunk_size = std::max(m_chunk_size, size + alignment);
+        m_chunks.push_back({std::unique_ptr<unsigned char[]>(new unsigned char[chunk_size]), chunk_size});
+        m_capacity += chunk_size;
+    }
+}
+
+void Arena::rewind(const Marker & marker)
+{
+    m_chunk = marker.chunk;
+    m_offset = marker.offset;
+    m_base = marker.base;
+}
+
+Arena & thread_arena()
+{
+    thread_local Arena arena;
+    return arena;
+}
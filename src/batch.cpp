@@ -0,0 +1,291 @@
+#include "batch.h"
+
+#include "arena.h"
+#include "decode.h"
+#include "divisor.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <type_traits>
+
+namespace calc {
+
+namespace {
+
+using ops::Op;
+
+const std::size_t groups = static_cast<std::size_t>(Op::FIRST_PLUGIN);
+
+template <class T>
+std::size_t sqrt_lanes(T * registers, const std::size_t count, std::uint64_t * errors)
+{
+    std::size_t failed = 0;
+    for (std::size_t begin = 0; begin < count; begin += 64) {
+        const std::size_t n = std::min<std::size_t>(64, count - begin);
+        T * x = registers + begin;
+        // The mask is built before the registers change, then the lanes are
+        // selected without branches so the loop maps onto packed sqrt
+        std::uint64_t bad = 0;
+        for (std::size_t k = 0; k < n; ++k) {
+            bad |= static_cast<std::uint64_t>(!(x[k] > 0)) << k;
+        }
+        for (std::size_t k = 0; k < n; ++k) {
+            const bool ok = x[k] > 0;
+            x[k] = ok ? std::sqrt(x[k]) : x[k];
+        }
+        if (errors != nullptr) {
+            errors[begin / 64] = bad;
+        }
+        failed += static_cast<std::size_t>(__builtin_popcountll(bad));
+    }
+    return failed;
+}
+
+template <class T>
+void neg_lanes(T * registers, const std::size_t count)
+{
+    for (std::size_t k = 0; k < count; ++k) {
+        registers[k] = -registers[k];
+    }
+}
+
+// Failed lanes are divided by 1 to keep the loop branch-free
+template <class T>
+void divide(T * left, const T * right, const std::size_t n)
+{
+    for (std::size_t k = 0; k < n; ++k) {
+        left[k] = left[k] / (right[k] != 0 ? right[k] : 1);
+    }
+}
+
+template <class T>
+void remainder(T * left, const T * right, const std::size_t n)
+{
+    for (std::size_t k = 0; k < n; ++k) {
+        if (right[k] != 0) {
+            left[k] = std::fmod(left[k], right[k]);
+        }
+    }
+}
+
+// Requests of a group keep their order, so a divisor repeated by consecutive
+// requests forms a run, and long runs share the precomputed divisor
+const std::size_t min_divisor_run = 16;
+
+void divide_runs(const Op op, double * left, const double * right, const std::size_t n)
+{
+    for (std::size_t begin = 0; begin < n;) {
+        std::size_t end = begin + 1;
+        while (end < n && right[end] == right[begin]) {
+            ++end;
+        }
+        const std::size_t size = end - begin;
+        if (size >= min_divisor_run && right[begin] != 0) {
+            const Divisor divisor(right[begin]);
+            if (op == Op::DIV) {
+                divisor.divide(left + begin, size);
+            }
+            else {
+                divisor.remainder(left + begin, size);
+            }
+        }
+        else if (op == Op::DIV) {
+            divide(left + begin, right + begin, size);
+        }
+        else {
+            remainder(left + begin, right + begin, size);
+        }
+        begin = end;
+    }
+}
+
+// Kernels over one group: left[k] = left[k] op right[k]. Lanes which fail
+// keep their left value, like the scalar engine keeps the register.
+template <class T>
+void apply(const Op op, T * left, const T * right, Status * status, const std::size_t n)
+{
+    switch (op) {
+    case Op::SET:
+        for (std::size_t k = 0; k < n; ++k) {
+            left[k] = right[k];
+        }
+        break;
+    case Op::ADD:
+        for (std::size_t k = 0; k < n; ++k) {
+            left[k] = left[k] + right[k];
+        }
+        break;
+    case Op::SUB:
+        for (std::size_t k = 0; k < n; ++k) {
+            left[k] = left[k] - right[k];
+        }
+        break;
+    case Op::MUL:
+        for (std::size_t k = 0; k < n; ++k) {
+            left[k] = left[k] * right[k];
+        }
+        break;
+    case Op::DIV:
+        if constexpr (std::is_same_v<T, double>) {
+            divide_runs(op, left, right, n);
+        }
+        else {
+            divide(left, right, n);
+        }
+        for (std::size_t k = 0; k < n; ++k) {
+            status[k] = right[k] != 0 ? Status::Ok : Status::DivisionByZero;
+        }
+        return;
+    case Op::REM:
+        if constexpr (std::is_same_v<T, double>) {
+            divide_runs(op, left, right, n);
+        }
+        else {
+            remainder(left, right, n);
+        }
+        for (std::size_t k = 0; k < n; ++k) {
+            status[k] = right[k] != 0 ? Status::Ok : Status::RemainderByZero;
+        }
+        return;
+    case Op::POW:
+        for (std::size_t k = 0; k < n; ++k) {
+            left[k] = std::pow(left[k], right[k]);
+        }
+        break;
+    case Op::NEG:
+        neg_lanes(left, n);
+        break;
+    case Op::SQRT:
+        for (std::size_t k = 0; k < n; ++k) {
+            status[k] = left[k] > 0 ? Status::Ok : Status::BadSqrt;
+        }
+        sqrt_lanes(left, n, nullptr);
+        return;
+    default:
+        return;
+    }
+}
+
+// Requests are processed in blocks small enough for the staging arrays to
+// stay in cache between decoding, the kernels and the scatter
+const std::size_t block_size = 1024;
+
+template <class T>
+struct Staging
+{
+    Op * op_of;
+    double * arg_of;
+    std::size_t * order;
+    T * left;
+    T * right;
+    Status * status;
+};
+
+template <class T>
+std::size_t evaluate_block(T * registers, const std::string_view * lines, const std::size_t count, Status * statuses, const Staging<T> & staging)
+{
+    // Decode, counting requests per operation; the rest is evaluated in place
+    std::size_t failed = 0;
+    std::array<std::size_t, groups + 1> offsets = {};
+    for (std::size_t i = 0; i < count; ++i) {
+        if (decode_simple(lines[i], staging.op_of[i], staging.arg_of[i])) {
+            ++offsets[static_cast<std::size_t>(staging.op_of[i]) + 1];
+            continue;
+        }
+        staging.op_of[i] = Op::ERR;
+        const auto status = evaluate(registers[i], lines[i]);
+        failed += status != Status::Ok ? 1 : 0;
+        if (statuses != nullptr) {
+            statuses[i] = status;
+        }
+    }
+    for (std::size_t g = 1; g <= groups; ++g) {
+        offsets[g] += offsets[g - 1];
+    }
+
+    // Gather every group into contiguous registers and arguments
+    std::array<std::size_t, groups> next = {};
+    std::copy(offsets.begin(), offsets.end() - 1, next.begin());
+    for (std::size_t i = 0; i < count; ++i) {
+        if (staging.op_of[i] == Op::ERR) {
+            continue;
+        }
+        const std::size_t k = next[static_cast<std::size_t>(staging.op_of[i])]++;
+        staging.order[k] = i;
+        staging.left[k] = registers[i];
+        staging.right[k] = staging.arg_of[i];
+        staging.status[k] = Status::Ok;
+    }
+
+    for (std::size_t g = 1; g < groups; ++g) {
+        const std::size_t begin = offsets[g];
+        apply(static_cast<Op>(g), staging.left + begin, staging.right + begin, staging.status + begin, offsets[g + 1] - begin);
+    }
+
+    // Scatter results back in request order
+    for (std::size_t k = 0; k < offsets[groups]; ++k) {
+        const std::size_t i = staging.order[k];
+        registers[i] = staging.left[k];
+        failed += staging.status[k] != Status::Ok ? 1 : 0;
+        if (statuses != nullptr) {
+            statuses[i] = staging.status[k];
+        }
+    }
+    return failed;
+}
+
+template <class T>
+std::size_t evaluate_blocks(T * registers, const std::string_view * lines, const std::size_t count, Status * statuses)
+{
+    Arena & arena = thread_arena();
+    const Arena::Scope scope(arena);
+    const std::size_t n = std::min(count, block_size);
+    const Staging<T> staging{
+            arena.allocate_array<Op>(n),
+            arena.allocate_array<double>(n),
+            arena.allocate_array<std::size_t>(n),
+            arena.allocate_array<T>(n),
+            arena.allocate_array<T>(n),
+            arena.allocate_array<Status>(n)};
+    std::size_t failed = 0;
+    for (std::size_t begin = 0; begin < count; begin += block_size) {
+        const std::size_t size = std::min(block_size, count - begin);
+        failed += evaluate_block(registers + begin, lines + begin, size, statuses != nullptr ? statuses + begin : nullptr, staging);
+    }
+    return failed;
+}
+
+} // anonymous namespace
+
+std::size_t evaluate_batch(double * registers, const std::string_view * lines, const std::size_t count, Status * statuses)
+{
+    return evaluate_blocks(registers, lines, count, statuses);
+}
+
+std::size_t evaluate_batch(float * registers, const std::string_view * lines, const std::size_t count, Status * statuses)
+{
+    return evaluate_blocks(registers, lines, count, statuses);
+}
+
+std::size_t sqrt_batch(double * registers, const std::size_t count, std::uint64_t * errors)
+{
+    return sqrt_lanes(registers, count, errors);
+}
+
+std::size_t sqrt_batch(float * registers, const std::size_t count, std::uint64_t * errors)
+{
+    return sqrt_lanes(registers, count, errors);
+}
+
+void neg_batch(double * registers, const std::size_t count)
+{
+    neg_lanes(registers, count);
+}
+
+void neg_batch(float * registers, const std::size_t count)
+{
+    neg_lanes(registers, count);
+}
+
+} // namespace calc
@@ -1,71 +1,69 @@
 #include "calc.h"
 
+#include "arena.h"
+#include "cpu_time.h"
+#include "decode.h"
+#include "divisor.h"
+#include "operators.h"
+
 #include <cctype>   // for std::isspace
 #include <cmath>    // various math functions
 #include <iostream> // for error reporting via std::cerr
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 namespace {
 
 const std::size_t max_decimal_digits = 10;
+// Folds check the time limit once per this number of arguments
+const std::size_t time_check_period = 1024;
 
-enum class Op
-{
-    ERR,
-    SET,
-    ADD,
-    SUB,
-    MUL,
-    DIV,
-    REM,
-    NEG,
-    POW,
-    SQRT
-};
-
-std::size_t arity(const Op op)
+using ops::arity;
+using ops::Op;
+
+// Safe character access: positions past the end read as '\0'
+char at(const std::string_view line, const std::size_t i)
 {
-    switch (op) {
-    // error
-    case Op::ERR: return 0;
-    // unary
-    case Op::NEG: return 1;
-    case Op::SQRT: return 1;
-    // binary
-    case Op::SET: return 2;
-    case Op::ADD: return 2;
-    case Op::SUB: return 2;
-    case Op::MUL: return 2;
-    case Op::DIV: return 2;
-    case Op::REM: return 2;
-    case Op::POW: return 2;
-    }
+    return i < line.size() ? line[i] : '\0';
 }
 
-Op parse_op(const std::string & line, std::size_t & i, bool & fold)
+Op parse_op(const std::string_view line, std::size_t & i, bool & fold, std::ostream & err, calc::Status & status)
 {
-    const auto rollback = [&i, &line, &fold](const std::size_t n) {
-        if (fold) {
-            i--;
-        }
-        i -= n;
-        std::cerr << "Unknown operation " << line << std::endl;
-        return Op::ERR;
-    };
-
     // Returns ret if fold operation is correct, otherwise Op::ERR
-    const auto validate_fold = [&i, &line, &fold](const Op ret) {
+    const auto validate_fold = [&i, &line, &fold, &err, &status](const Op ret) {
         if (fold && (i >= line.size() || line[i++] != ')')) {
-            std::cerr << "Incorrect folded operation specified " << line << std::endl;
+            calc::diagnostics(err, calc::Status::BadFold) << "Incorrect folded operation specified " << line << std::endl;
+            status = calc::Status::BadFold;
             return Op::ERR;
         }
         return ret;
     };
 
-    if (line[i] == '(') {
+    // Not a built-in operation, look for a plugin one before giving up
+    const auto rollback = [&i, &line, &fold, &err, &status, &validate_fold](const std::size_t n) {
+        if (fold) {
+            i--;
+        }
+        i -= n;
+        const std::size_t start = fold ? i + 1 : i;
+        Op plugin = Op::ERR;
+        std::size_t length = 0;
+        if (ops::find_plugin(line.substr(start), plugin, length)) {
+            i = start + length;
+            return validate_fold(plugin);
+        }
+        calc::diagnostics(err, calc::Status::UnknownOperation) << "Unknown operation " << line << std::endl;
+        status = calc::Status::UnknownOperation;
+        return Op::ERR;
+    };
+
+    if (at(line, i) == '(') {
         fold = true;
         i++;
     }
-    switch (line[i++]) {
+    switch (at(line, i++)) {
     case '0':
     case '1':
     case '2':
@@ -93,11 +91,11 @@ Op parse_op(const std::string & line, std::size_t & i, bool & fold)
     case '^':
         return validate_fold(Op::POW);
     case 'S':
-        switch (line[i++]) {
+        switch (at(line, i++)) {
         case 'Q':
-            switch (line[i++]) {
+            switch (at(line, i++)) {
             case 'R':
-                switch (line[i++]) {
+                switch (at(line, i++)) {
                 case 'T':
                     return validate_fold(Op::SQRT);
                 default:
@@ -114,7 +112,7 @@ Op parse_op(const std::string & line, std::size_t & i, bool & fold)
     }
 }
 
-std::size_t skip_ws(const std::string & line, std::size_t i)
+std::size_t skip_ws(const std::string_view line, std::size_t i)
 {
     while (i < line.size() && std::isspace(line[i])) {
         ++i;
@@ -122,7 +120,7 @@ std::size_t skip_ws(const std::string & line, std::size_t i)
     return i;
 }
 
-bool parse_arg(const std::string & line, std::size_t & i, double & res, const bool fold)
+calc::Status parse_arg(const std::string_view line, std::size_t & i, double & res, const bool fold, std::ostream & err)
 {
     res = 0;
     std::size_t count = 0;
@@ -168,126 +166,390 @@ bool parse_arg(const std::string & line, std::size_t & i, double & res, const bo
         }
     }
     if (!good) {
-        std::cerr << "Argument parsing error at " << i << ": '" << line.substr(i) << "'" << std::endl;
-        return false;
+        calc::diagnostics(err, calc::Status::BadArgument) << "Argument parsing error at " << i << ": '" << line.substr(i) << "'" << std::endl;
+        return calc::Status::BadArgument;
     }
     else if (i < line.size() && count >= max_decimal_digits) {
-        std::cerr << "Argument isn't fully parsed, suffix left: '" << line.substr(i) << "'" << std::endl;
-        return false;
+        calc::diagnostics(err, calc::Status::ArgumentTooLong) << "Argument isn't fully parsed, suffix left: '" << line.substr(i) << "'" << std::endl;
+        return calc::Status::ArgumentTooLong;
     }
-    return true;
+    return calc::Status::Ok;
 }
 
-double unary(const double current, const Op op)
+// Applies a plugin operator, the register is kept intact on failure.
+// Plugin kernels work on double, a float register is rounded once after them.
+template <class T>
+calc::Status plugin_scalar(const Op op, T & left, const T right, std::ostream & err)
+{
+    const auto & info = ops::info(op);
+    double res = left;
+    if (info.scalar == nullptr || info.scalar(&res, right) != 0) {
+        calc::diagnostics(err, calc::Status::OperationFailed) << "Bad argument for " << info.spelling << ": " << (info.arity == 1 ? left : right) << std::endl;
+        return calc::Status::OperationFailed;
+    }
+    left = res;
+    return calc::Status::Ok;
+}
+
+// Applies a plugin fold kernel to all arguments at once
+template <class T>
+calc::Status plugin_fold(const Op op, T & left, const double * args, const std::size_t count, std::ostream & err)
+{
+    const auto & info = ops::info(op);
+    double res = left;
+    if (info.fold(&res, args, count) != 0) {
+        calc::diagnostics(err, calc::Status::OperationFailed) << "Bad arguments for " << info.spelling << " fold" << std::endl;
+        return calc::Status::OperationFailed;
+    }
+    left = res;
+    return calc::Status::Ok;
+}
+
+template <class T>
+calc::Status unary(T & current, const Op op, std::ostream & err)
 {
     switch (op) {
     case Op::NEG:
-        return -current;
+        current = -current;
+        return calc::Status::Ok;
     case Op::SQRT:
         if (current > 0) {
-            return std::sqrt(current);
+            current = std::sqrt(current);
+            return calc::Status::Ok;
         }
         else {
-            std::cerr << "Bad argument for SQRT: " << current << std::endl;
-            [[fallthrough]];
+            calc::diagnostics(err, calc::Status::BadSqrt) << "Bad argument for SQRT: " << current << std::endl;
+            return calc::Status::BadSqrt;
         }
     default:
-        return current;
+        return plugin_scalar<T>(op, current, 0, err);
     }
 }
 
-bool n_ary(const Op op, double & left, const double right)
+template <class T>
+calc::Status n_ary(const Op op, T & left, const T right, std::ostream & err)
 {
     switch (op) {
     case Op::SET:
         left = right;
-        return true;
+        return calc::Status::Ok;
     case Op::ADD:
         left = left + right;
-        return true;
+        return calc::Status::Ok;
     case Op::SUB:
         left = left - right;
-        return true;
+        return calc::Status::Ok;
     case Op::MUL:
         left = left * right;
-        return true;
+        return calc::Status::Ok;
     case Op::DIV:
         if (right != 0) {
             left = left / right;
-            return true;
+            return calc::Status::Ok;
         }
         else {
-            std::cerr << "Bad right argument for division: " << right << std::endl;
-            return false;
+            calc::diagnostics(err, calc::Status::DivisionByZero) << "Bad right argument for division: " << right << std::endl;
+            return calc::Status::DivisionByZero;
         }
     case Op::REM:
         if (right != 0) {
             left = std::fmod(left, right);
-            return true;
+            return calc::Status::Ok;
         }
         else {
-            std::cerr << "Bad right argument for remainder: " << right << std::endl;
-            return false;
+            calc::diagnostics(err, calc::Status::RemainderByZero) << "Bad right argument for remainder: " << right << std::endl;
+            return calc::Status::RemainderByZero;
         }
     case Op::POW:
         left = std::pow(left, right);
-        return true;
+        return calc::Status::Ok;
     default:
-        return false;
+        return plugin_scalar(op, left, right, err);
     }
 }
 
-} // anonymous namespace
+// Checks the right argument of an operation without applying it
+calc::Status validate_arg(const Op op, const double right, std::ostream & err)
+{
+    double left = 0;
+    switch (op) {
+    case Op::DIV:
+    case Op::REM:
+        return n_ary(op, left, right, err);
+    default:
+        return calc::Status::Ok;
+    }
+}
 
-double process_line(const double current, const std::string & line)
+// Parses the line and, if Evaluate is set, applies it to current.
+// The register is left unchanged if the line is malformed or can't be applied.
+// Arguments are parsed in double and rounded once to a float register.
+template <bool Evaluate, class T>
+calc::Status run_line(T & current, const std::string_view line, std::ostream & err, const calc::LineLimits * limits = nullptr, calc::LineInfo * info = nullptr)
 {
+    if (info != nullptr) {
+        *info = {};
+    }
+    if (limits != nullptr && limits->max_bytes != 0 && line.size() > limits->max_bytes) {
+        calc::diagnostics(err, calc::Status::LineTooLong) << "Line too long: " << line.size() << " bytes, limit " << limits->max_bytes << std::endl;
+        return calc::Status::LineTooLong;
+    }
+    const std::size_t max_arguments = limits != nullptr && limits->max_arguments != 0 ? limits->max_arguments : static_cast<std::size_t>(-1);
+    const auto deadline = limits != nullptr && limits->max_time.count() != 0 ? thread_cpu_time() + limits->max_time : std::chrono::nanoseconds::max();
+
     std::size_t i = 0;
     bool fold = false;
-    const auto op = parse_op(line, i, fold);
+    auto status = calc::Status::Ok;
+    const auto op = parse_op(line, i, fold, err, status);
+    if (info != nullptr) {
+        info->op = static_cast<unsigned>(op);
+    }
 
     switch (arity(op)) {
     case 2: {
-        bool error = false;
-        int arg_counter = 0;
-        double new_value = current;
+        // Plugin folds with their own kernel get all arguments at once,
+        // staged in the thread arena (every argument takes at least 2 chars)
+        const bool collect = fold && ops::info(op).fold != nullptr;
+        Arena & arena = thread_arena();
+        const Arena::Scope scope(arena);
+        double * args = collect ? arena.allocate_array<double>(line.size() / 2 + 1) : nullptr;
+        std::size_t arg_counter = 0;
+        T new_value = current;
+        double previous = 0;
+        std::optional<calc::Divisor> divisor;
         do {
             i = skip_ws(line, i);
             const auto old_i = i;
             double arg;
-            const bool success = parse_arg(line, i, arg, fold);
+            status = parse_arg(line, i, arg, fold, err);
             if (i == old_i) {
                 if (fold && i >= line.size() && arg_counter >= 1) { // Trailing whitespaces are ok if there is at least 1 argument
                     break;
                 }
-                std::cerr << "No argument for a binary operation" << std::endl;
-                error = true;
-                break;
+                calc::diagnostics(err, calc::Status::MissingArgument) << "No argument for a binary operation" << std::endl;
+                return calc::Status::MissingArgument;
             }
-            else if (!success) {
-                error = true;
-                break;
+            else if (status != calc::Status::Ok) {
+                return status;
             }
             arg_counter++;
-            bool res = n_ary(op, new_value, arg);
-            if (!res) {
-                error = true;
-                break;
+            if (arg_counter > max_arguments) {
+                calc::diagnostics(err, calc::Status::TooManyArguments) << "Too many arguments, limit " << max_arguments << std::endl;
+                return calc::Status::TooManyArguments;
+            }
+            if (arg_counter % time_check_period == 0 && thread_cpu_time() > deadline) {
+                calc::diagnostics(err, calc::Status::TimeLimitExceeded) << "Time limit exceeded after " << arg_counter << " arguments" << std::endl;
+                return calc::Status::TimeLimitExceeded;
+            }
+            if (info != nullptr) {
+                info->arguments = arg_counter;
+            }
+            if (collect) {
+                args[arg_counter - 1] = arg;
+                continue;
+            }
+            if constexpr (std::is_same_v<T, double>) {
+                // A divisor repeated by a fold is precomputed once
+                if (Evaluate && (op == Op::DIV || op == Op::REM) && arg != 0 && arg == previous) {
+                    if (!divisor || divisor->value() != arg) {
+                        divisor.emplace(arg);
+                    }
+                    new_value = op == Op::DIV ? divisor->divide(new_value) : divisor->remainder(new_value);
+                    continue;
+                }
+                previous = arg;
+            }
+            status = Evaluate ? n_ary<T>(op, new_value, arg, err) : validate_arg(op, arg, err);
+            if (status != calc::Status::Ok) {
+                return status;
             }
         } while (fold && i < line.size());
 
-        if (error) {
-            break;
+        if (Evaluate && collect) {
+            status = plugin_fold(op, new_value, args, arg_counter, err);
+            if (status != calc::Status::Ok) {
+                return status;
+            }
         }
-        return new_value;
+
+        current = new_value;
+        return calc::Status::Ok;
     }
     case 1: {
         if (i < line.size()) {
-            std::cerr << "Unexpected suffix for a unary operation: '" << line.substr(i) << "'" << std::endl;
-            break;
+            calc::diagnostics(err, calc::Status::UnarySuffix) << "Unexpected suffix for a unary operation: '" << line.substr(i) << "'" << std::endl;
+            return calc::Status::UnarySuffix;
+        }
+        return Evaluate ? unary(current, op, err) : calc::Status::Ok;
+    }
+    default: return status;
+    }
+}
+
+} // anonymous namespace
+
+double process_line(const double current, const std::string & line)
+{
+    double result = current;
+    run_line<true>(result, line, std::cerr);
+    return result;
+}
+
+bool check_line(const std::string_view line, std::ostream & err)
+{
+    double unused = 0;
+    return run_line<false>(unused, line, err) == calc::Status::Ok;
+}
+
+namespace calc {
+
+std::ostream & null_stream()
+{
+    // A stream without a buffer fails every output before any formatting
+    thread_local std::ostream stream(nullptr);
+    return stream;
+}
+
+namespace {
+
+// Slot of the filter in the extensible storage of a stream
+int filter_index()
+{
+    static const int index = std::ios_base::xalloc();
+    return index;
+}
+
+} // anonymous namespace
+
+void set_diagnostic_filter(std::ostream & err, const DiagnosticFilter * filter)
+{
+    err.pword(filter_index()) = const_cast<DiagnosticFilter *>(filter);
+}
+
+std::ostream & diagnostics(std::ostream & err, const Status status)
+{
+    const auto * filter = static_cast<const DiagnosticFilter *>(err.pword(filter_index()));
+    return filter == nullptr || filter->wants(status) ? err : null_stream();
+}
+
+bool decode_simple(const std::string_view line, Op & op, double & arg)
+{
+    std::size_t i = 0;
+    bool fold = false;
+    auto status = Status::Ok;
+    arg = 0;
+    op = parse_op(line, i, fold, null_stream(), status);
+    if (fold || op == Op::ERR || op >= Op::FIRST_PLUGIN) {
+        return false;
+    }
+    if (arity(op) == 1) {
+        return i == line.size();
+    }
+    i = skip_ws(line, i);
+    const auto old_i = i;
+    // Without a fold a successfully parsed argument ends the line
+    return parse_arg(line, i, arg, false, null_stream()) == Status::Ok && i != old_i;
+}
+
+Status decode(const std::string_view line, Op & op, bool & fold, std::vector<double> & args, std::ostream & err)
+{
+    std::size_t i = 0;
+    fold = false;
+    auto status = Status::Ok;
+    op = parse_op(line, i, fold, err, status);
+    const std::size_t first = args.size();
+    switch (arity(op)) {
+    case 2:
+        do {
+            i = skip_ws(line, i);
+            const auto old_i = i;
+            double arg;
+            status = parse_arg(line, i, arg, fold, err);
+            if (i == old_i) {
+                if (fold && i >= line.size() && args.size() > first) {
+                    break;
+                }
+                diagnostics(err, Status::MissingArgument) << "No argument for a binary operation" << std::endl;
+                return Status::MissingArgument;
+            }
+            else if (status != Status::Ok) {
+                return status;
+            }
+            args.push_back(arg);
+        } while (fold && i < line.size());
+        return Status::Ok;
+    case 1:
+        if (i < line.size()) {
+            diagnostics(err, Status::UnarySuffix) << "Unexpected suffix for a unary operation: '" << line.substr(i) << "'" << std::endl;
+            return Status::UnarySuffix;
         }
-        return unary(current, op);
+        return Status::Ok;
+    default: return status;
     }
-    default: break;
+}
+
+Status apply(double & current, const Op op, const bool fold, const double * args, const std::size_t count, std::ostream & err)
+{
+    if (arity(op) == 1) {
+        return unary(current, op, err);
+    }
+    double new_value = current;
+    if (fold && ops::info(op).fold != nullptr) {
+        const auto status = plugin_fold(op, new_value, args, count, err);
+        if (status != Status::Ok) {
+            return status;
+        }
+    }
+    else {
+        for (std::size_t k = 0; k < count; ++k) {
+            const auto status = n_ary(op, new_value, args[k], err);
+            if (status != Status::Ok) {
+                return status;
+            }
+        }
     }
-    return current;
+    current = new_value;
+    return Status::Ok;
 }
+
+Status evaluate(double & current, const std::string_view line, std::ostream & err)
+{
+    return run_line<true>(current, line, err);
+}
+
+Status evaluate(double & current, const std::string_view line)
+{
+    return run_line<true>(current, line, null_stream());
+}
+
+Status evaluate(double & current, const std::string_view line, std::ostream & err, const LineLimits & limits)
+{
+    return run_line<true>(current, line, err, &limits);
+}
+
+Status evaluate(double & current, const std::string_view line, std::ostream & err, const LineLimits & limits, LineInfo & info)
+{
+    return run_line<true>(current, line, err, &limits, &info);
+}
+
+Status evaluate(float & current, const std::string_view line, std::ostream & err)
+{
+    return run_line<true>(current, line, err);
+}
+
+Status evaluate(float & current, const std::string_view line)
+{
+    return run_line<true>(current, line, null_stream());
+}
+
+Status evaluate(float & current, const std::string_view line, std::ostream & err, const LineLimits & limits)
+{
+    return run_line<true>(current, line, err, &limits);
+}
+
+Status evaluate(float & current, const std::string_view line, std::ostream & err, const LineLimits & limits, LineInfo & info)
+{
+    return run_line<true>(current, line, err, &limits, &info);
+}
+
+} // namespace calc
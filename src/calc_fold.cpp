@@ -0,0 +1,171 @@
+#include "calc_fold.h"
+
+#include "arena.h"
+#include "batch.h"
+#include "calc.h"
+#include "session.h"
+
+#include <cstring>
+#include <new>
+#include <string_view>
+
+struct calc_handle
+{
+    calc::Session session;
+};
+
+namespace {
+
+calc_status to_c(const calc::Status status)
+{
+    // The C codes are the values of the statuses
+    using calc::Status;
+    static_assert(CALC_OK == static_cast<int>(Status::Ok));
+    static_assert(CALC_UNKNOWN_OPERATION == static_cast<int>(Status::UnknownOperation));
+    static_assert(CALC_BAD_FOLD == static_cast<int>(Status::BadFold));
+    static_assert(CALC_BAD_ARGUMENT == static_cast<int>(Status::BadArgument));
+    static_assert(CALC_ARGUMENT_TOO_LONG == static_cast<int>(Status::ArgumentTooLong));
+    static_assert(CALC_MISSING_ARGUMENT == static_cast<int>(Status::MissingArgument));
+    static_assert(CALC_UNARY_SUFFIX == static_cast<int>(Status::UnarySuffix));
+    static_assert(CALC_DIVISION_BY_ZERO == static_cast<int>(Status::DivisionByZero));
+    static_assert(CALC_REMAINDER_BY_ZERO == static_cast<int>(Status::RemainderByZero));
+    static_assert(CALC_BAD_SQRT == static_cast<int>(Status::BadSqrt));
+    static_assert(CALC_OPERATION_FAILED == static_cast<int>(Status::OperationFailed));
+    static_assert(CALC_LINE_TOO_LONG == static_cast<int>(Status::LineTooLong));
+    static_assert(CALC_TOO_MANY_ARGUMENTS == static_cast<int>(Status::TooManyArguments));
+    static_assert(CALC_TIME_LIMIT_EXCEEDED == static_cast<int>(Status::TimeLimitExceeded));
+    static_assert(CALC_SESSION_EXHAUSTED == static_cast<int>(Status::SessionExhausted));
+    return static_cast<calc_status>(status);
+}
+
+} // anonymous namespace
+
+calc_handle * calc_create(const double initial)
+{
+    return new (std::nothrow) calc_handle{calc::Session({}, initial)};
+}
+
+void calc_destroy(calc_handle * handle)
+{
+    delete handle;
+}
+
+double calc_value(const calc_handle * handle)
+{
+    return handle != nullptr ? handle->session.value() : 0;
+}
+
+void calc_set_value(calc_handle * handle, const double value)
+{
+    if (handle != nullptr) {
+        handle->session.set_value(value);
+    }
+}
+
+calc_status calc_eval(calc_handle * handle, const char * line, const size_t size)
+{
+    if (handle == nullptr) {
+        return CALC_BAD_HANDLE;
+    }
+    return to_c(handle->session.eval({line, size}));
+}
+
+void calc_set_limits(calc_handle * handle, const calc_limits * limits)
+{
+    if (handle == nullptr || limits == nullptr) {
+        return;
+    }
+    calc::Limits res;
+    res.line.max_bytes = limits->max_line_bytes;
+    res.line.max_arguments = limits->max_arguments;
+    res.line.max_time = std::chrono::nanoseconds(limits->max_line_time_ns);
+    res.max_bytes = limits->max_session_bytes;
+    res.max_time = std::chrono::nanoseconds(limits->max_session_time_ns);
+    handle->session.set_limits(res);
+}
+
+void calc_get_admission(const calc_handle * handle, calc_admission * admission)
+{
+    if (handle == nullptr || admission == nullptr) {
+        return;
+    }
+    const auto & counters = handle->session.admission();
+    admission->admitted = counters.admitted;
+    admission->rejected_too_long = counters.rejected_too_long;
+    admission->aborted_arguments = counters.aborted_arguments;
+    admission->aborted_time = counters.aborted_time;
+    admission->rejected_session = counters.rejected_session;
+    admission->bytes = counters.bytes;
+    admission->time_ns = static_cast<uint64_t>(counters.time.count());
+}
+
+size_t calc_eval_batch(calc_handle * handle, const calc_line * lines, const size_t count, double * results, calc_status * statuses)
+{
+    if (handle == nullptr) {
+        return count;
+    }
+    size_t failed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const auto status = handle->session.eval({lines[i].data, lines[i].size});
+        failed += status != calc::Status::Ok ? 1 : 0;
+        if (results != nullptr) {
+            results[i] = handle->session.value();
+        }
+        if (statuses != nullptr) {
+            statuses[i] = to_c(status);
+        }
+    }
+    return failed;
+}
+
+size_t calc_eval_text(calc_handle * handle, const char * text, const size_t size, double * results, calc_status * statuses, const size_t capacity, size_t * evaluated)
+{
+    size_t n = 0;
+    size_t failed = 0;
+    if (handle != nullptr) {
+        const std::string_view rest(text, size);
+        for (size_t begin = 0; begin < size && n < capacity; ++n) {
+            const char * newline = static_cast<const char *>(std::memchr(text + begin, '\n', size - begin));
+            const size_t end = newline != nullptr ? static_cast<size_t>(newline - text) : size;
+            const auto status = handle->session.eval(rest.substr(begin, end - begin));
+            failed += status != calc::Status::Ok ? 1 : 0;
+            if (results != nullptr) {
+                results[n] = handle->session.value();
+            }
+            if (statuses != nullptr) {
+                statuses[n] = to_c(status);
+            }
+            begin = end + 1;
+        }
+    }
+    if (evaluated != nullptr) {
+        *evaluated = n;
+    }
+    return failed;
+}
+
+size_t calc_eval_independent(double * registers, const calc_line * lines, const size_t count, calc_status * statuses)
+{
+    Arena & arena = thread_arena();
+    const Arena::Scope scope(arena);
+    auto * views = arena.allocate_array<std::string_view>(count);
+    for (size_t i = 0; i < count; ++i) {
+        views[i] = {lines[i].data, lines[i].size};
+    }
+    auto * status = statuses != nullptr ? arena.allocate_array<calc::Status>(count) : nullptr;
+    const size_t failed = calc::evaluate_batch(registers, views, count, status);
+    for (size_t i = 0; status != nullptr && i < count; ++i) {
+        statuses[i] = to_c(status[i]);
+    }
+    return failed;
+}
+
+size_t calc_sqrt_batch(double * registers, const size_t count, uint64_t * errors)
+{
+    return calc::sqrt_batch(registers, count, errors);
+}
+
+void calc_neg_batch(double * registers, const size_t count)
+{
+    calc::neg_batch(registers, count);
+}
@@ -0,0 +1,90 @@
+#include "check.h"
+
+#include "calc.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Chunks smaller than this aren't worth a separate thread
+const std::size_t min_chunk_size = 1 << 20;
+
+struct Chunk
+{
+    std::string_view text;
+    std::size_t lines = 0;
+    // (line number inside the chunk, diagnostics) for every malformed line
+    std::vector<std::pair<std::size_t, std::string>> errors;
+};
+
+// Splits text into at most n pieces, each ending right after a newline
+std::vector<Chunk> split(const std::string_view text, const std::size_t n)
+{
+    std::vector<Chunk> chunks;
+    const std::size_t step = std::max(min_chunk_size, text.size() / std::max<std::size_t>(n, 1) + 1);
+    std::size_t begin = 0;
+    while (begin < text.size()) {
+        std::size_t end = std::min(begin + step, text.size());
+        if (end < text.size()) {
+            const auto newline = text.find('\n', end - 1);
+            end = newline == std::string_view::npos ? text.size() : newline + 1;
+        }
+        chunks.emplace_back();
+        chunks.back().text = text.substr(begin, end - begin);
+        begin = end;
+    }
+    return chunks;
+}
+
+void check_chunk(Chunk & chunk)
+{
+    std::ostringstream diagnostics;
+    const auto text = chunk.text;
+    std::size_t begin = 0;
+    while (begin < text.size()) {
+        auto end = text.find('\n', begin);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        if (!check_line(text.substr(begin, end - begin), diagnostics)) {
+            chunk.errors.emplace_back(chunk.lines, diagnostics.str());
+            diagnostics.str({});
+        }
+        ++chunk.lines;
+        begin = end + 1;
+    }
+}
+
+} // anonymous namespace
+
+std::size_t check_text(const std::string_view text, const std::string_view name, const unsigned threads, std::ostream & err)
+{
+    auto chunks = split(text, threads);
+    // Chunks are spread over NUMA nodes like the ranges of parallel_for
+    const auto & topology = Topology::system();
+    std::vector<std::size_t> nodes(chunks.size());
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        nodes[i] = topology.node_of(i, chunks.size());
+    }
+    run_on_nodes(nodes, topology, [&chunks](const std::size_t i) { check_chunk(chunks[i]); });
+
+    std::size_t errors = 0;
+    std::size_t first_line = 1;
+    for (const auto & chunk : chunks) {
+        for (const auto & [line, diagnostics] : chunk.errors) {
+            std::istringstream messages(diagnostics);
+            for (std::string message; std::getline(messages, message);) {
+                err << name << ':' << first_line + line << ": " << message << '\n';
+            }
+        }
+        errors += chunk.errors.size();
+        first_line += chunk.lines;
+    }
+    return errors;
+}
@@ -0,0 +1,81 @@
+#include "column_output.h"
+
+#include "output.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+const std::uint32_t column_count = 5;
+
+// Zero bytes padding columns to the alignment
+const char padding[column_alignment] = {};
+
+std::size_t pad(const std::size_t size)
+{
+    return (column_alignment - size % column_alignment) % column_alignment;
+}
+
+} // anonymous namespace
+
+ColumnOutput::ColumnOutput(const int fd, const std::size_t batch_rows)
+    : m_fd(fd)
+    , m_batch_rows(std::max<std::size_t>(batch_rows, 1))
+    , m_line(new std::uint64_t[m_batch_rows])
+    , m_result(new double[m_batch_rows])
+    , m_arguments(new std::uint32_t[m_batch_rows])
+    , m_op(new std::uint16_t[m_batch_rows])
+    , m_status(new std::uint16_t[m_batch_rows])
+{
+    ColumnFileHeader header = {};
+    std::memcpy(header.magic, "CALCCOL", 8);
+    header.version = 1;
+    header.byte_order = 0x01020304;
+    header.columns = column_count;
+    header.batch_rows = static_cast<std::uint32_t>(m_batch_rows);
+    header.alignment = column_alignment;
+    iovec iov = {&header, sizeof(header)};
+    m_failed = !write_fully(m_fd, &iov, 1);
+}
+
+bool ColumnOutput::finish()
+{
+    if (m_rows != 0) {
+        write_batch();
+    }
+    // The end marker is a batch without rows
+    write_batch();
+    return !m_failed;
+}
+
+void ColumnOutput::write_batch()
+{
+    const std::size_t rows = m_rows;
+    m_rows = 0;
+    if (m_failed) {
+        return;
+    }
+    ColumnBatchHeader header = {};
+    header.rows = rows;
+    header.first_line = rows != 0 ? m_line[0] : 0;
+
+    // Columns go straight from their arrays, followed by their padding
+    const std::pair<const void *, std::size_t> columns[column_count] = {
+            {m_line.get(), rows * sizeof(std::uint64_t)},
+            {m_result.get(), rows * sizeof(double)},
+            {m_arguments.get(), rows * sizeof(std::uint32_t)},
+            {m_op.get(), rows * sizeof(std::uint16_t)},
+            {m_status.get(), rows * sizeof(std::uint16_t)}};
+    iovec iov[1 + 2 * column_count];
+    std::size_t count = 0;
+    iov[count++] = {&header, sizeof(header)};
+    for (const auto & column : columns) {
+        iov[count++] = {const_cast<void *>(column.first), column.second};
+        iov[count++] = {const_cast<char *>(padding), pad(column.second)};
+    }
+    m_failed = !write_fully(m_fd, iov, count);
+}
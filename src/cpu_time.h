@@ -0,0 +1,12 @@
+#pragma once
+
+#include <chrono>
+#include <ctime>
+
+// CPU time consumed by the calling thread
+inline std::chrono::nanoseconds thread_cpu_time()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
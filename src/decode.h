@@ -0,0 +1,25 @@
+#pragma once
+
+#include "calc.h"
+#include "operators.h"
+
+#include <cstddef>
+#include <iosfwd>
+#include <string_view>
+#include <vector>
+
+namespace calc {
+
+// Silently parses a line consisting of one built-in operation and at most one
+// argument. Folds, plugin operations and malformed lines are rejected.
+bool decode_simple(std::string_view line, ops::Op & op, double & arg);
+
+// Parses a whole line into its operation and arguments, which are appended
+// to args, without applying it. Diagnostics of a malformed line go to err,
+// args may then have some of its arguments appended.
+Status decode(std::string_view line, ops::Op & op, bool & fold, std::vector<double> & args, std::ostream & err);
+
+// Applies a decoded line exactly like evaluate() applies its text
+Status apply(double & current, ops::Op op, bool fold, const double * args, std::size_t count, std::ostream & err);
+
+} // namespace calc
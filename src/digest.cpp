@@ -0,0 +1,45 @@
+#include "digest.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const std::uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+const std::uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+const std::uint64_t prime3 = 0x165667B19E3779F9ULL;
+
+std::uint64_t rotl(const std::uint64_t x, const int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+} // anonymous namespace
+
+void Digest::update(const double value)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    m_acc ^= rotl(bits * prime2, 31) * prime1;
+    m_acc = rotl(m_acc, 27) * prime1 + prime3;
+    ++m_lines;
+}
+
+std::uint64_t Digest::value() const
+{
+    // XXH64 avalanche of the accumulator mixed with the length
+    std::uint64_t h = m_acc + m_lines * 8;
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string Digest::str() const
+{
+    char buffer[48];
+    const int n = std::snprintf(buffer, sizeof(buffer), "%016llx %llu", static_cast<unsigned long long>(value()), static_cast<unsigned long long>(m_lines));
+    return {buffer, static_cast<std::size_t>(n)};
+}
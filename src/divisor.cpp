@@ -0,0 +1,69 @@
+#include "divisor.h"
+
+namespace calc {
+
+namespace {
+
+// Integers below this are exact, as are their products with the quotient
+const double max_integral = 0x1p52;
+
+} // anonymous namespace
+
+Divisor::Divisor(const double divisor)
+    : m_divisor(divisor)
+    , m_reciprocal(1 / divisor)
+    , m_magnitude(std::fabs(divisor))
+{
+    int exponent = 0;
+    const bool finite = std::isfinite(divisor);
+    m_power_of_two = finite && std::fabs(std::frexp(divisor, &exponent)) == 0.5 && std::isnormal(m_reciprocal);
+    m_integral = finite && m_magnitude < max_integral && std::trunc(divisor) == divisor;
+}
+
+double Divisor::fast_remainder(const double x) const
+{
+    const double a = std::fabs(x);
+    const double reciprocal = std::fabs(m_reciprocal);
+    if (m_integral && a < max_integral && std::trunc(a) == a) {
+        // The truncated quotient is off by at most one
+        double r = a - std::trunc(a * reciprocal) * m_magnitude;
+        if (r < 0) {
+            r += m_magnitude;
+        }
+        else if (r >= m_magnitude) {
+            r -= m_magnitude;
+        }
+        return std::copysign(r, x);
+    }
+    if (m_power_of_two && std::isfinite(x)) {
+        // Scaling is exact, and so is the subtraction by Sterbenz lemma
+        const double q = std::trunc(a * reciprocal);
+        if (std::isfinite(q)) {
+            return std::copysign(a - q * m_magnitude, x);
+        }
+    }
+    return std::fmod(x, m_divisor);
+}
+
+void Divisor::divide(double * x, const std::size_t count) const
+{
+    if (m_power_of_two) {
+        for (std::size_t k = 0; k < count; ++k) {
+            x[k] *= m_reciprocal;
+        }
+    }
+    else {
+        for (std::size_t k = 0; k < count; ++k) {
+            x[k] /= m_divisor;
+        }
+    }
+}
+
+void Divisor::remainder(double * x, const std::size_t count) const
+{
+    for (std::size_t k = 0; k < count; ++k) {
+        x[k] = remainder(x[k]);
+    }
+}
+
+} // namespace calc
@@ -0,0 +1,112 @@
+#include "error_report.h"
+
+#include <iterator>
+#include <ostream>
+
+namespace {
+
+using calc::Status;
+
+// Names of the categories, indexed by status
+const char * const category_names[] = {
+        "",
+        "unknown operation",
+        "bad fold",
+        "bad argument",
+        "argument too long",
+        "missing argument",
+        "unary suffix",
+        "division by zero",
+        "remainder by zero",
+        "bad SQRT argument",
+        "operation failed",
+        "line too long",
+        "too many arguments",
+        "time limit exceeded",
+        "session limit exceeded",
+};
+
+} // anonymous namespace
+
+ErrorReport::ErrorReport(std::ostream & err, const std::uint64_t examples, const std::uint64_t summary_every)
+    : m_err(err)
+    , m_examples(examples)
+    , m_summary_every(summary_every)
+    , m_sink(err.rdbuf())
+{
+    static_assert(std::size(category_names) == categories);
+    m_sink.copyfmt(err);
+    calc::set_diagnostic_filter(m_sink, this);
+}
+
+Status ErrorReport::eval(calc::Session & session, const std::string_view line)
+{
+    ++m_lines;
+    const auto status = session.eval(line, m_sink);
+    record(status);
+    after_line();
+    return status;
+}
+
+Status ErrorReport::eval(calc::Session & session, const std::string_view line, calc::LineInfo & info)
+{
+    ++m_lines;
+    const auto status = session.eval(line, m_sink, info);
+    record(status);
+    after_line();
+    return status;
+}
+
+Status ErrorReport::reject_too_long(calc::Session & session, const std::size_t bytes)
+{
+    ++m_lines;
+    const auto status = session.reject_too_long(bytes, m_sink);
+    record(status);
+    after_line();
+    return status;
+}
+
+void ErrorReport::after_line()
+{
+    if (m_summary_every != 0 && m_lines % m_summary_every == 0 && m_errors != m_summarized) {
+        summary("Errors so far");
+    }
+}
+
+void ErrorReport::finish()
+{
+    if (m_errors != 0) {
+        summary("Errors");
+    }
+}
+
+void ErrorReport::record(const Status status)
+{
+    if (status != Status::Ok) {
+        ++m_errors;
+        ++m_counts[static_cast<std::size_t>(status)];
+    }
+}
+
+bool ErrorReport::wants(const Status status) const
+{
+    return m_counts[static_cast<std::size_t>(status)] < m_examples;
+}
+
+void ErrorReport::summary(const char * title)
+{
+    m_summarized = m_errors;
+    m_err << title << ": " << m_errors << " in " << m_lines << " lines (";
+    const char * separator = "";
+    for (std::size_t i = 1; i < categories; ++i) {
+        if (m_counts[i] == 0) {
+            continue;
+        }
+        m_err << separator << category_names[i] << ' ' << m_counts[i];
+        if (m_counts[i] > m_examples) {
+            m_err << ", " << m_examples << " shown";
+        }
+        separator = "; ";
+    }
+    m_err << ')' << std::endl;
+}
@@ -0,0 +1,86 @@
+#include "line_reader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+LineReader::LineReader(const int fd, const std::size_t max_line_bytes, const std::size_t block_size)
+    : m_fd(fd)
+    , m_max_line_bytes(max_line_bytes)
+    , m_block_size(block_size)
+{
+}
+
+bool LineReader::next(Batch & batch)
+{
+    batch = {};
+    if (m_eof) {
+        return false;
+    }
+    // The carry lives in the other arena, which is kept until the next call
+    m_current ^= 1;
+    auto & arena = m_arenas[m_current];
+    arena.reset();
+
+    // Reading at least as much as is carried keeps long lines linear
+    const std::size_t block = std::max(m_block_size, m_carry.size());
+    char * buffer = arena.allocate_array<char>(m_carry.size() + block);
+    if (!m_carry.empty()) {
+        std::memcpy(buffer, m_carry.data(), m_carry.size());
+    }
+    ssize_t n;
+    do {
+        n = read(m_fd, buffer + m_carry.size(), block);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        m_eof = true;
+        m_error = n < 0 ? errno : 0;
+        // After an error the last line may be incomplete, it isn't returned
+        if (n < 0 || (m_carry.empty() && !m_skipping)) {
+            return false;
+        }
+        auto * line = arena.allocate_array<Line>(1);
+        *line = m_skipping ? Line{{}, m_skipped} : Line{{buffer, m_carry.size()}, 0};
+        batch = {line, 1};
+        return true;
+    }
+
+    const std::string_view text(buffer, m_carry.size() + static_cast<std::size_t>(n));
+    auto * lines = arena.allocate_array<Line>(static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n')));
+    std::size_t count = 0;
+    std::size_t begin = 0;
+    for (auto end = text.find('\n'); end != std::string_view::npos; begin = end + 1, end = text.find('\n', begin)) {
+        const auto line = text.substr(begin, end - begin);
+        if (m_skipping) {
+            lines[count++] = {{}, m_skipped + line.size()};
+            m_skipping = false;
+        }
+        else if (m_max_line_bytes != 0 && line.size() > m_max_line_bytes) {
+            lines[count++] = {{}, line.size()};
+        }
+        else {
+            lines[count++] = {line, 0};
+        }
+    }
+
+    const auto tail = text.substr(begin);
+    m_carry = {};
+    if (m_skipping) {
+        m_skipped += tail.size();
+    }
+    else if (m_max_line_bytes != 0 && tail.size() > m_max_line_bytes) {
+        m_skipping = true;
+        m_skipped = tail.size();
+    }
+    else {
+        m_carry = tail;
+    }
+    batch = {lines, count};
+    return true;
+}
+
+std::size_t LineReader::peak() const
+{
+    return std::max(m_arenas[0].peak(), m_arenas[1].peak());
+}
@@ -1,13 +1,583 @@
 #include "calc.h"
+#include "calc_plugin.h"
+#include "check.h"
+#include "column_output.h"
+#include "digest.h"
+#include "error_report.h"
+#include "line_reader.h"
+#include "mapped_output.h"
+#include "output.h"
+#include "ordered_output.h"
+#include "parallel.h"
+#include "script.h"
+#include "sequence.h"
+#include "session.h"
+#include "value_filter.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
-int main()
+namespace {
+
+struct Options
+{
+    bool check = false;
+    bool digest = false;
+    // Print an intermediate digest every N lines (0 - only the final one)
+    std::uint64_t digest_every = 0;
+    bool stats = false;
+    // Evaluate with a float register
+    bool single = false;
+    // Lines may hold several operations separated by ';'
+    bool sequences = false;
+    // Print the value after every operation of a line, not only the last one
+    bool intermediates = false;
+    // Accept def/call statements
+    bool script = false;
+    // Pre-compose affine operations of scripts
+    bool affine = false;
+    // Values to print and the N or threshold of the filter
+    ValueFilter::Mode filter = ValueFilter::Mode::All;
+    double filter_parameter = 0;
+    // Aggregate diagnostics: print this many failing lines per error category
+    bool aggregate_errors = false;
+    std::uint64_t error_examples = 0;
+    // Print an error summary every N lines (0 - only the final report)
+    std::uint64_t error_summary_every = 0;
+    // Threads evaluating files, 0 - one per hardware thread
+    unsigned jobs = 0;
+    // Write results of all files to the standard output instead of <file>.out
+    bool combined = false;
+    // Hand output pages to a pipe with vmsplice instead of copying them
+    bool splice = false;
+    // Write results to this file through mappings, formatting them on --jobs threads
+    std::string output;
+    // Write line numbers, operations, fold lengths, results and statuses to
+    // this file as binary columns instead of printing results
+    std::string columns;
+    calc::Limits limits;
+    std::vector<std::string> plugins;
+    std::vector<std::string> files;
+};
+
+void usage()
+{
+    std::cerr << "Usage: calc_fold [--plugin path]... [limits] [--float] [--sequences [--intermediates]] [--script [--affine]] [filter] [errors] [--stats] [--vmsplice | --output file | --columns file] [--digest [--digest-every N]]\n"
+                 "       calc_fold [--plugin path]... [limits] [--float] [--sequences [--intermediates]] [--script [--affine]] [filter] [errors] [--jobs N] [--combined] file...\n"
+                 "       calc_fold [--plugin path]... --check [file...]\n"
+                 "Limits: --max-line-bytes N --max-args N --max-line-ms N --max-session-bytes N --max-session-ms N\n"
+                 "Filter: --final | --every N | --changes | --crossing threshold\n"
+                 "Errors: --error-examples K [--error-summary-every N]"
+              << std::endl;
+}
+
+bool parse_options(const std::vector<std::string> & args, Options & options)
+{
+    unsigned filters = 0;
+    const auto filter = [&](const ValueFilter::Mode mode, const double parameter = 0) {
+        options.filter = mode;
+        options.filter_parameter = parameter;
+        ++filters;
+    };
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        const auto & arg = args[i];
+        if (arg == "--check") {
+            options.check = true;
+        }
+        else if (arg == "--digest") {
+            options.digest = true;
+        }
+        else if (arg == "--digest-every" && i + 1 < args.size()) {
+            options.digest_every = std::stoull(args[++i]);
+        }
+        else if (arg == "--plugin" && i + 1 < args.size()) {
+            options.plugins.push_back(args[++i]);
+        }
+        else if (arg == "--jobs" && i + 1 < args.size()) {
+            options.jobs = static_cast<unsigned>(std::stoul(args[++i]));
+        }
+        else if (arg == "--combined") {
+            options.combined = true;
+        }
+        else if (arg == "--output" && i + 1 < args.size()) {
+            options.output = args[++i];
+        }
+        else if (arg == "--columns" && i + 1 < args.size()) {
+            options.columns = args[++i];
+        }
+        else if (arg == "--vmsplice") {
+            options.splice = true;
+        }
+        else if (arg == "--float") {
+            options.single = true;
+        }
+        else if (arg == "--sequences") {
+            options.sequences = true;
+        }
+        else if (arg == "--intermediates") {
+            options.intermediates = true;
+        }
+        else if (arg == "--script") {
+            options.script = true;
+        }
+        else if (arg == "--affine") {
+            options.affine = true;
+        }
+        else if (arg == "--final") {
+            filter(ValueFilter::Mode::Final);
+        }
+        else if (arg == "--every" && i + 1 < args.size()) {
+            const auto n = std::stoull(args[++i]);
+            if (n == 0) {
+                return false;
+            }
+            filter(ValueFilter::Mode::Every, static_cast<double>(n));
+        }
+        else if (arg == "--changes") {
+            filter(ValueFilter::Mode::Changes);
+        }
+        else if (arg == "--crossing" && i + 1 < args.size()) {
+            filter(ValueFilter::Mode::Crossing, std::stod(args[++i]));
+        }
+        else if (arg == "--error-examples" && i + 1 < args.size()) {
+            options.aggregate_errors = true;
+            options.error_examples = std::stoull(args[++i]);
+        }
+        else if (arg == "--error-summary-every" && i + 1 < args.size()) {
+            options.error_summary_every = std::stoull(args[++i]);
+        }
+        else if (arg == "--stats") {
+            options.stats = true;
+        }
+        else if (arg == "--max-line-bytes" && i + 1 < args.size()) {
+            options.limits.line.max_bytes = std::stoull(args[++i]);
+        }
+        else if (arg == "--max-args" && i + 1 < args.size()) {
+            options.limits.line.max_arguments = std::stoull(args[++i]);
+        }
+        else if (arg == "--max-line-ms" && i + 1 < args.size()) {
+            options.limits.line.max_time = std::chrono::milliseconds(std::stoull(args[++i]));
+        }
+        else if (arg == "--max-session-bytes" && i + 1 < args.size()) {
+            options.limits.max_bytes = std::stoull(args[++i]);
+        }
+        else if (arg == "--max-session-ms" && i + 1 < args.size()) {
+            options.limits.max_time = std::chrono::milliseconds(std::stoull(args[++i]));
+        }
+        else if (!arg.empty() && arg.front() == '-') {
+            return false;
+        }
+        else {
+            options.files.push_back(arg);
+        }
+    }
+    // Scripts run on a double register and print a value per statement
+    const bool script_ok = !options.script || (!options.single && options.columns.empty());
+    // Column files hold a row per line, so they aren't filtered
+    const bool filter_ok = filters <= 1 && (filters == 0 || options.columns.empty());
+    const bool errors_ok = options.aggregate_errors || options.error_summary_every == 0;
+    // Output modes, statistics and digests are only there for the standard input
+    const bool stdin_ok = options.check || options.files.empty() ||
+            (!options.digest && options.output.empty() && options.columns.empty() && !options.splice && !options.stats);
+    const bool digest_ok = options.digest || options.digest_every == 0;
+    return script_ok && filter_ok && errors_ok && stdin_ok && digest_ok;
+}
+
+std::string read_all(std::istream & in)
+{
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    return std::move(buffer).str();
+}
+
+unsigned threads(const unsigned jobs)
+{
+    return jobs != 0 ? jobs : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Validate-only mode: calc_fold --check [file...]
+int check(const std::vector<std::string> & files, const unsigned threads)
+{
+    std::size_t errors = 0;
+    if (files.empty()) {
+        errors += check_text(read_all(std::cin), "<stdin>", threads, std::cerr);
+    }
+    for (const auto & file : files) {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) {
+            std::cerr << "Cannot open " << file << std::endl;
+            ++errors;
+            continue;
+        }
+        errors += check_text(read_all(in), file, threads, std::cerr);
+    }
+    std::cerr << std::flush;
+    return errors == 0 ? 0 : 1;
+}
+
+// Diagnostics of evaluated lines go through this report, which prints all of
+// them unless errors are aggregated
+ErrorReport make_report(const Options & options, std::ostream & err)
+{
+    const auto examples = options.aggregate_errors ? options.error_examples : std::numeric_limits<std::uint64_t>::max();
+    return {err, examples, options.error_summary_every};
+}
+
+// Evaluates input line by line, passing the register value after every line
+// (or every operation with --intermediates) kept by filter and the 1-based
+// number of its line to sink, and calling flush after every portion of
+// input. Diagnostics go to err, the final error report with --error-examples
+// as well. at_line is called with the number of every line before the line
+// is evaluated and with 0 when the input has ended, before the final
+// messages, so diagnostics can be attributed to their lines. Returns false
+// if the input ends inside a script statement.
+template <class Sink, class Flush, class AtLine>
+bool evaluate_input(const Options & options, calc::Session & session, LineReader & reader, std::ostream & err, ValueFilter filter, Sink && sink, Flush && flush, AtLine && at_line)
+{
+    std::uint64_t number = 0;
+    calc::Script script(options.affine);
+    auto report = make_report(options, err);
+    const auto emit = [&](const double value, const std::uint64_t line) {
+        if (filter.keep(value)) {
+            sink(value, line);
+        }
+    };
+    for (LineReader::Batch batch; reader.next(batch);) {
+        for (std::size_t i = 0; i < batch.size; ++i) {
+            const auto & line = batch.lines[i];
+            at_line(++number);
+            // Script statements, which may span lines, print one value when they are complete
+            const auto kind = options.script && line.skipped == 0 ? script.feed(session, line.text, err) : calc::Script::Line::Plain;
+            if (kind == calc::Script::Line::Consumed) {
+                continue;
+            }
+            if (kind == calc::Script::Line::Evaluated) {
+                emit(session.value(), number);
+                continue;
+            }
+            if (line.skipped != 0) {
+                report.reject_too_long(session, line.skipped);
+            }
+            else if (options.sequences) {
+                calc::for_each_operation(line.text, [&](const std::string_view operation) {
+                    report.eval(session, operation);
+                    if (options.intermediates) {
+                        emit(session.value(), number);
+                    }
+                });
+                if (options.intermediates) {
+                    continue;
+                }
+            }
+            else {
+                report.eval(session, line.text);
+            }
+            emit(session.value(), number);
+        }
+        flush();
+    }
+    at_line(0);
+    const bool complete = script.finish(err);
+    if (options.aggregate_errors) {
+        report.finish();
+    }
+    double value;
+    if (filter.last(value)) {
+        sink(value, number);
+    }
+    flush();
+    return complete;
+}
+
+template <class Sink, class Flush>
+bool evaluate_input(const Options & options, calc::Session & session, LineReader & reader, std::ostream & err, ValueFilter filter, Sink && sink, Flush && flush)
+{
+    return evaluate_input(options, session, reader, err, std::move(filter), sink, flush, [](std::uint64_t) {});
+}
+
+ValueFilter make_filter(const Options & options, const calc::Session & session)
+{
+    return {options.filter, options.filter_parameter, session.value()};
+}
+
+void print_stats(const calc::Session & session, const LineReader & reader)
 {
-    double current = 0;
-    for (std::string line; std::getline(std::cin, line);) {
-        current = process_line(current, line);
-        std::cout << current << std::endl;
+    const auto & admission = session.admission();
+    std::cerr << "admitted " << admission.admitted
+              << ", rejected as too long " << admission.rejected_too_long
+              << ", aborted by argument limit " << admission.aborted_arguments
+              << ", aborted by time limit " << admission.aborted_time
+              << ", rejected by session limits " << admission.rejected_session
+              << ", bytes " << admission.bytes
+              << ", cpu " << std::chrono::duration_cast<std::chrono::milliseconds>(admission.time).count() << " ms"
+              << ", arena peak " << reader.peak() + thread_arena().peak() << " bytes"
+              << std::endl;
+}
+
+// Digest-only mode: results are hashed instead of being printed
+bool digest(const Options & options, calc::Session & session, LineReader & reader)
+{
+    Digest digest;
+    const bool complete = evaluate_input(
+            options,
+            session,
+            reader,
+            std::cerr,
+            make_filter(options, session),
+            [&](const double value, std::uint64_t) {
+                digest.update(value);
+                if (options.digest_every != 0 && digest.lines() % options.digest_every == 0) {
+                    std::cout << digest.str() << '\n';
+                }
+            },
+            [] { std::cout.flush(); });
+    std::cout << digest.str() << std::endl;
+    return complete;
+}
+
+// Columnar mode: results with their line descriptions are written to a
+// column file (include/column_output.h) without any formatting
+bool columns(const Options & options, calc::Session & session, LineReader & reader)
+{
+    const int fd = open(options.columns.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        std::cerr << "Cannot create " << options.columns << std::endl;
+        return false;
+    }
+    ColumnOutput output(fd);
+    auto report = make_report(options, std::cerr);
+    std::uint64_t number = 0;
+    const auto eval = [&](const std::string_view operation) {
+        calc::LineInfo info;
+        const auto status = report.eval(session, operation, info);
+        output.put(number, session.value(), status, info);
+    };
+    for (LineReader::Batch batch; reader.next(batch);) {
+        for (std::size_t i = 0; i < batch.size; ++i) {
+            const auto & line = batch.lines[i];
+            ++number;
+            if (line.skipped != 0) {
+                output.put(number, session.value(), report.reject_too_long(session, line.skipped), {});
+            }
+            else if (options.sequences) {
+                // Every operation gets its own row
+                calc::for_each_operation(line.text, eval);
+            }
+            else {
+                eval(line.text);
+            }
+        }
+    }
+    if (options.aggregate_errors) {
+        report.finish();
+    }
+    const bool written = output.finish();
+    const bool ok = close(fd) == 0 && written;
+    if (!ok) {
+        std::cerr << "Cannot write " << options.columns << std::endl;
+    }
+    return ok;
+}
+
+// Evaluates a file with its own register. Results go to out and
+// diagnostics, prefixed with "<file>:<line>: ", to err; flush is called after
+// every portion of input. Returns false if the file can't be read or ends
+// inside a script statement.
+template <class Flush>
+bool evaluate_file(const Options & options, const std::string & name, std::ostream & out, std::ostream & err, Flush && flush)
+{
+    const int fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        err << "Cannot open " << name << '\n';
+        return false;
+    }
+    calc::Session session(options.limits);
+    session.set_single_precision(options.single);
+    LineReader reader(fd, options.limits.line.max_bytes);
+    std::ostringstream diagnostics;
+    // Diagnostics are collected per line and prefixed with the number of the
+    // line which produced them, whether or not it printed a value
+    std::uint64_t current = 0;
+    const auto at_line = [&](const std::uint64_t line) {
+        if (diagnostics.tellp() > 0) {
+            std::istringstream messages(diagnostics.str());
+            for (std::string message; std::getline(messages, message);) {
+                err << name << ':' << current << ": " << message << '\n';
+            }
+            diagnostics.str({});
+        }
+        current = line;
+    };
+    const bool complete = evaluate_input(
+            options,
+            session,
+            reader,
+            diagnostics,
+            make_filter(options, session),
+            [&out](const double value, std::uint64_t) { out << value << '\n'; },
+            flush,
+            at_line);
+    // The final messages (unclosed statement, error report) follow the last line
+    std::istringstream messages(diagnostics.str());
+    for (std::string message; std::getline(messages, message);) {
+        err << name << ": " << message << '\n';
+    }
+    if (reader.error() != 0) {
+        err << "Cannot read " << name << ": " << std::strerror(reader.error()) << '\n';
+    }
+    flush();
+    close(fd);
+    return complete && reader.error() == 0;
+}
+
+// Batch mode: calc_fold [--jobs N] [--combined] file...
+// Files are independent jobs. By default they run on a work-stealing pool and
+// results go to <file>.out. With --combined results and diagnostics of all
+// files are stitched into the standard streams in the order of files.
+int evaluate_files(const Options & options)
+{
+    const unsigned n = threads(options.jobs);
+    const std::size_t count = options.files.size();
+    std::atomic<bool> ok{true};
+    if (options.combined) {
+        // Files may run at most this far ahead of the one being written
+        const std::size_t window = 2 * std::size_t{n};
+        OrderedOutput out(STDOUT_FILENO, window);
+        OrderedOutput err(STDERR_FILENO, window);
+        parallel_for_ordered(count, n, [&](const std::size_t i) {
+            out.begin(i);
+            err.begin(i);
+            std::ostringstream results, diagnostics;
+            const auto flush = [&] {
+                out.write(i, results.str());
+                err.write(i, diagnostics.str());
+                results.str({});
+                diagnostics.str({});
+            };
+            if (!evaluate_file(options, options.files[i], results, diagnostics, flush)) {
+                ok = false;
+            }
+            flush();
+            out.end(i);
+            err.end(i);
+        });
+        return out.finish() && err.finish() && ok ? 0 : 1;
+    }
+
+    std::mutex mutex;
+    parallel_for(count, n, [&](const std::size_t i) {
+        const auto & name = options.files[i];
+        std::ostringstream diagnostics;
+        std::ofstream out(name + ".out", std::ios::binary);
+        if (!out) {
+            diagnostics << "Cannot create " << name << ".out\n";
+        }
+        if (!out || !evaluate_file(options, name, out, diagnostics, [] {}) || !out.flush()) {
+            ok = false;
+        }
+        // Diagnostics of a file are printed together once it is done
+        std::lock_guard<std::mutex> lock(mutex);
+        std::cerr << diagnostics.str() << std::flush;
+    });
+    return ok ? 0 : 1;
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    Options options;
+    try {
+        if (!parse_options({argv + 1, argv + argc}, options)) {
+            usage();
+            return 2;
+        }
+    }
+    catch (const std::logic_error &) {
+        usage();
+        return 2;
+    }
+    for (const auto & plugin : options.plugins) {
+        if (calc_load_plugin(plugin.c_str()) != CALC_PLUGIN_OK) {
+            std::cerr << "Cannot load plugin " << plugin << std::endl;
+            return 2;
+        }
+    }
+    if (options.check) {
+        return check(options.files, threads(options.jobs));
+    }
+    if (!options.files.empty()) {
+        return evaluate_files(options);
+    }
+
+    calc::Session session(options.limits);
+    session.set_single_precision(options.single);
+    LineReader reader(STDIN_FILENO, options.limits.line.max_bytes);
+    bool complete = true;
+    if (options.digest) {
+        complete = digest(options, session, reader);
+    }
+    else if (!options.columns.empty()) {
+        if (!columns(options, session, reader)) {
+            return 1;
+        }
+    }
+    else if (!options.output.empty()) {
+        MappedOutput output(options.output, threads(options.jobs));
+        if (!output.is_open()) {
+            std::cerr << "Cannot create " << options.output << std::endl;
+            return 1;
+        }
+        complete = evaluate_input(
+                options,
+                session,
+                reader,
+                std::cerr,
+                make_filter(options, session),
+                [&output](const double value, std::uint64_t) { output.put(value); },
+                [] {});
+        if (!output.close()) {
+            std::cerr << "Cannot write " << options.output << std::endl;
+            return 1;
+        }
+    }
+    else {
+        Output output(STDOUT_FILENO, options.splice);
+        complete = evaluate_input(
+                options,
+                session,
+                reader,
+                std::cerr,
+                make_filter(options, session),
+                [&output, &options](const double value, std::uint64_t) {
+                    if (options.single) {
+                        output.put(static_cast<float>(value));
+                    }
+                    else {
+                        output.put(value);
+                    }
+                },
+                [&output] { output.flush(); });
+    }
+    if (options.stats) {
+        print_stats(session, reader);
+    }
+    if (reader.error() != 0) {
+        std::cerr << "Cannot read the standard input: " << std::strerror(reader.error()) << std::endl;
+        return 1;
     }
+    return complete ? 0 : 1;
 }
@@ -0,0 +1,111 @@
+#include "mapped_output.h"
+
+#include "output.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// The file grows by at least this much at a time
+const std::uint64_t min_growth = 64 << 20;
+
+} // anonymous namespace
+
+MappedOutput::MappedOutput(const std::string & path, const unsigned threads, const std::size_t window)
+    : m_fd(open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666))
+    , m_threads(std::max(1u, threads))
+    , m_window(std::max<std::size_t>(window, 1))
+{
+    m_values.reserve(m_window);
+    // Every thread formats at most a ceil(window / threads) range
+    m_scratch_size = (m_window / m_threads + 1) * max_value_length;
+    m_scratch.resize(m_threads);
+    m_sizes.resize(m_threads);
+}
+
+MappedOutput::~MappedOutput()
+{
+    close();
+}
+
+bool MappedOutput::close()
+{
+    if (m_fd < 0) {
+        return false;
+    }
+    drain();
+    if (ftruncate(m_fd, static_cast<off_t>(m_size)) != 0 || ::close(m_fd) != 0) {
+        m_failed = true;
+    }
+    m_fd = -1;
+    return !m_failed;
+}
+
+void MappedOutput::drain()
+{
+    if (m_values.empty() || m_fd < 0 || m_failed) {
+        m_values.clear();
+        return;
+    }
+
+    // Format every range into its own scratch buffer. Range i is always
+    // formatted by worker i, pinned to the same NUMA node on every drain and
+    // never stolen from, so a buffer is allocated, first written and reused on
+    // that node and its pages stay local to it.
+    const std::size_t n = m_threads;
+    const std::size_t count = m_values.size();
+    const auto & topology = Topology::system();
+    std::vector<std::size_t> nodes(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        nodes[i] = topology.node_of(i, n);
+    }
+    run_on_nodes(nodes, topology, [&](const std::size_t i) {
+        if (m_scratch[i] == nullptr) {
+            m_scratch[i].reset(new char[m_scratch_size]);
+        }
+        char * out = m_scratch[i].get();
+        for (std::size_t k = count * i / n; k < count * (i + 1) / n; ++k) {
+            out = format_value(out, m_values[k]);
+        }
+        m_sizes[i] = static_cast<std::size_t>(out - m_scratch[i].get());
+    });
+    std::uint64_t total = 0;
+    for (const auto size : m_sizes) {
+        total += size;
+    }
+
+    if (m_size + total > m_allocated) {
+        const std::uint64_t growth = std::max({min_growth, total, m_allocated / 2});
+        if (posix_fallocate(m_fd, static_cast<off_t>(m_allocated), static_cast<off_t>(m_size + growth - m_allocated)) != 0) {
+            m_failed = true;
+            m_values.clear();
+            return;
+        }
+        m_allocated = m_size + growth;
+    }
+
+    // Map the pages of the new data and copy the ranges to their offsets
+    const std::uint64_t page = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+    const std::uint64_t start = m_size / page * page;
+    const std::uint64_t length = m_size + total - start;
+    void * map = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, static_cast<off_t>(start));
+    if (map == MAP_FAILED) {
+        m_failed = true;
+        m_values.clear();
+        return;
+    }
+    char * base = static_cast<char *>(map) + (m_size - start);
+    std::vector<std::size_t> offsets(n, 0);
+    for (std::size_t i = 1; i < n; ++i) {
+        offsets[i] = offsets[i - 1] + m_sizes[i - 1];
+    }
+    parallel_for(n, m_threads, [&](const std::size_t i) { std::memcpy(base + offsets[i], m_scratch[i].get(), m_sizes[i]); });
+    munmap(map, length);
+    m_size += total;
+    m_values.clear();
+}
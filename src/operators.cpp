@@ -0,0 +1,119 @@
+#include "operators.h"
+
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <dlfcn.h>
+#include <mutex>
+
+namespace ops {
+
+namespace {
+
+const std::size_t max_operators = 256;
+const std::size_t max_spelling = 32;
+
+// Entries are only appended: readers see a consistent prefix of the table
+// without locking, writers are serialized by the mutex
+std::array<Info, max_operators> entries = {
+        Info{"", 0, nullptr, nullptr},    // ERR
+        Info{"", 2, nullptr, nullptr},    // SET
+        Info{"+", 2, nullptr, nullptr},   // ADD
+        Info{"-", 2, nullptr, nullptr},   // SUB
+        Info{"*", 2, nullptr, nullptr},   // MUL
+        Info{"/", 2, nullptr, nullptr},   // DIV
+        Info{"%", 2, nullptr, nullptr},   // REM
+        Info{"_", 1, nullptr, nullptr},   // NEG
+        Info{"^", 2, nullptr, nullptr},   // POW
+        Info{"SQRT", 1, nullptr, nullptr} // SQRT
+};
+std::array<std::array<char, max_spelling>, max_operators> spellings = {};
+std::atomic<std::size_t> size{static_cast<std::size_t>(Op::FIRST_PLUGIN)};
+std::mutex mutex;
+
+// Spellings which the built-in parser would (partially) consume are rejected
+bool valid_spelling(const std::string_view spelling)
+{
+    if (spelling.empty() || spelling.size() >= max_spelling) {
+        return false;
+    }
+    for (const char c : spelling) {
+        if (!std::isgraph(static_cast<unsigned char>(c))) {
+            return false;
+        }
+    }
+    const char first = spelling.front();
+    return !std::isdigit(static_cast<unsigned char>(first)) && std::strchr("()+-*/%_^", first) == nullptr && spelling.substr(0, 4) != "SQRT";
+}
+
+} // anonymous namespace
+
+const Info & info(const Op op)
+{
+    return entries[static_cast<std::size_t>(op)];
+}
+
+bool find_plugin(const std::string_view text, Op & op, std::size_t & length)
+{
+    const std::size_t n = size.load(std::memory_order_acquire);
+    length = 0;
+    for (std::size_t i = static_cast<std::size_t>(Op::FIRST_PLUGIN); i < n; ++i) {
+        const auto spelling = entries[i].spelling;
+        if (spelling.size() > length && text.substr(0, spelling.size()) == spelling) {
+            op = static_cast<Op>(i);
+            length = spelling.size();
+        }
+    }
+    return length != 0;
+}
+
+int add(const calc_operator & op)
+{
+    if (op.spelling == nullptr || op.scalar == nullptr || (op.arity != 1 && op.arity != 2)) {
+        return CALC_PLUGIN_BAD_OPERATOR;
+    }
+    const std::string_view spelling = op.spelling;
+    if (!valid_spelling(spelling)) {
+        return CALC_PLUGIN_BAD_OPERATOR;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::size_t n = size.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (entries[i].spelling == spelling) {
+            return CALC_PLUGIN_DUPLICATE;
+        }
+    }
+    if (n == max_operators) {
+        return CALC_PLUGIN_TABLE_FULL;
+    }
+    auto & storage = spellings[n];
+    std::memcpy(storage.data(), spelling.data(), spelling.size());
+    entries[n] = Info{{storage.data(), spelling.size()}, op.arity, op.scalar, op.fold};
+    size.store(n + 1, std::memory_order_release);
+    return CALC_PLUGIN_OK;
+}
+
+} // namespace ops
+
+int calc_register_operator(const calc_operator * op)
+{
+    return op != nullptr ? ops::add(*op) : CALC_PLUGIN_BAD_OPERATOR;
+}
+
+int calc_load_plugin(const char * path)
+{
+    // Plugins are never unloaded: their kernels stay in the table
+    void * handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr) {
+        return CALC_PLUGIN_LOAD_FAILED;
+    }
+    using init_fn = int (*)(calc_register_operator_fn);
+    const auto init = reinterpret_cast<init_fn>(dlsym(handle, "calc_fold_plugin_init"));
+    if (init == nullptr) {
+        dlclose(handle);
+        return CALC_PLUGIN_LOAD_FAILED;
+    }
+    return init(calc_register_operator);
+}
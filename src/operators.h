@@ -0,0 +1,48 @@
+#pragma once
+
+#include "calc_plugin.h"
+
+#include <cstddef>
+#include <string_view>
+
+// Table of operators shared by built-in and plugin ones. Built-in operators
+// occupy the first entries in the order of Op and are applied directly by
+// the engine, plugin operators follow them and are applied by their kernels.
+namespace ops {
+
+enum class Op
+{
+    ERR,
+    SET,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    REM,
+    NEG,
+    POW,
+    SQRT,
+    FIRST_PLUGIN
+};
+
+struct Info
+{
+    std::string_view spelling;
+    std::size_t arity;
+    calc_scalar_kernel scalar;
+    calc_fold_kernel fold;
+};
+
+const Info & info(Op op);
+
+inline std::size_t arity(const Op op)
+{
+    return info(op).arity;
+}
+
+// Finds the longest plugin operator spelled at the start of text
+bool find_plugin(std::string_view text, Op & op, std::size_t & length);
+
+int add(const calc_operator & op);
+
+} // namespace ops
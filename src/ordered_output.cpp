@@ -0,0 +1,160 @@
+#include "ordered_output.h"
+
+#include "output.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <iterator>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+void wait(sem_t & semaphore)
+{
+    while (sem_wait(&semaphore) != 0 && errno == EINTR) {
+    }
+}
+
+} // anonymous namespace
+
+OrderedOutput::OrderedOutput(const int fd, const std::size_t window, const std::size_t segment_bytes)
+    : m_fd(fd)
+    , m_segment_bytes(segment_bytes)
+    , m_slots(std::max<std::size_t>(window, 1))
+{
+    for (auto & slot : m_slots) {
+        sem_init(&slot.space, 0, 0);
+    }
+    sem_init(&m_ready, 0, 0);
+    m_writer = std::thread(&OrderedOutput::work, this);
+}
+
+OrderedOutput::~OrderedOutput()
+{
+    finish();
+    for (auto & slot : m_slots) {
+        sem_destroy(&slot.space);
+    }
+    sem_destroy(&m_ready);
+}
+
+void OrderedOutput::begin(const std::uint64_t sequence)
+{
+    sem_t wake;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (sequence < m_head + m_slots.size()) {
+            slot(sequence).sequence = sequence;
+            return;
+        }
+        sem_init(&wake, 0, 0);
+        m_waiters.push_back({sequence, &wake});
+    }
+    // The writer assigns the slot before waking us up
+    wait(wake);
+    sem_destroy(&wake);
+}
+
+void OrderedOutput::write(const std::uint64_t sequence, std::string data)
+{
+    if (data.empty()) {
+        return;
+    }
+    Slot & s = slot(sequence);
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        s.bytes += data.size();
+        s.pieces.push_back(std::move(data));
+        full = s.bytes > m_segment_bytes;
+        s.waiting = full;
+    }
+    sem_post(&m_ready);
+    if (full) {
+        wait(s.space);
+    }
+}
+
+void OrderedOutput::end(const std::uint64_t sequence)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        slot(sequence).done = true;
+    }
+    sem_post(&m_ready);
+}
+
+bool OrderedOutput::finish()
+{
+    if (m_writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_finishing = true;
+        }
+        sem_post(&m_ready);
+        m_writer.join();
+    }
+    return !m_failed;
+}
+
+void OrderedOutput::work()
+{
+    std::vector<std::string> pieces;
+    for (;;) {
+        wait(m_ready);
+        bool stop;
+        {
+            // Take everything ready from the head on: whole ended segments
+            // and what has been written so far to the first unfinished one
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (;;) {
+                Slot & s = slot(m_head);
+                if (s.sequence != m_head) {
+                    break;
+                }
+                std::move(s.pieces.begin(), s.pieces.end(), std::back_inserter(pieces));
+                s.pieces.clear();
+                s.bytes = 0;
+                if (s.waiting) {
+                    s.waiting = false;
+                    sem_post(&s.space);
+                }
+                if (!s.done) {
+                    break;
+                }
+                s.sequence = none;
+                s.done = false;
+                ++m_head;
+            }
+            // Segments which have entered the window get their slots
+            const auto entered = [this](const Waiter & waiter) {
+                if (waiter.sequence >= m_head + m_slots.size()) {
+                    return false;
+                }
+                slot(waiter.sequence).sequence = waiter.sequence;
+                sem_post(waiter.wake);
+                return true;
+            };
+            m_waiters.erase(std::remove_if(m_waiters.begin(), m_waiters.end(), entered), m_waiters.end());
+            stop = m_finishing && slot(m_head).sequence != m_head;
+        }
+        if (!m_failed && !write_all(pieces)) {
+            m_failed = true;
+        }
+        pieces.clear();
+        if (stop) {
+            return;
+        }
+    }
+}
+
+bool OrderedOutput::write_all(std::vector<std::string> & pieces)
+{
+    std::vector<iovec> iov;
+    iov.reserve(pieces.size());
+    for (auto & piece : pieces) {
+        iov.push_back({piece.data(), piece.size()});
+    }
+    return write_fully(m_fd, iov.data(), iov.size());
+}
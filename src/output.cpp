@@ -0,0 +1,163 @@
+#include "output.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+// Ring size for write(2), which copies the data right away
+const std::size_t write_buffer_size = 1 << 16;
+const std::size_t preferred_pipe_size = 1 << 20;
+
+bool is_pipe(const int fd)
+{
+    struct stat st;
+    return fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+} // anonymous namespace
+
+Output::Output(const int fd, const bool allow_splice)
+    : m_fd(fd)
+    , m_page_size(static_cast<std::size_t>(sysconf(_SC_PAGESIZE)))
+    , m_capacity(write_buffer_size)
+{
+#ifdef __linux__
+    if (allow_splice && is_pipe(fd)) {
+        // A larger pipe means fewer wake-ups of the reader, best effort
+        fcntl(fd, F_SETPIPE_SZ, static_cast<int>(preferred_pipe_size));
+        const int pipe_size = fcntl(fd, F_GETPIPE_SZ);
+        if (pipe_size > 0) {
+            m_splice = true;
+            m_capacity = std::max(write_buffer_size, 2 * static_cast<std::size_t>(pipe_size));
+        }
+    }
+#else
+    (void)allow_splice;
+#endif
+    m_capacity = (m_capacity + m_page_size - 1) / m_page_size * m_page_size;
+    void * ring = mmap(nullptr, m_capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    m_ring = static_cast<char *>(ring);
+    m_end = m_ring + m_capacity;
+    m_flushed = m_pos = m_ring;
+}
+
+Output::~Output()
+{
+    flush();
+    munmap(m_ring, m_capacity);
+}
+
+void Output::write(std::string_view text)
+{
+    while (!text.empty()) {
+        if (m_pos == m_end) {
+            make_room();
+        }
+        const std::size_t n = std::min(text.size(), static_cast<std::size_t>(m_end - m_pos));
+        std::copy_n(text.data(), n, m_pos);
+        m_pos += n;
+        text.remove_prefix(n);
+    }
+}
+
+bool Output::flush()
+{
+    if (m_pos != m_flushed && !m_failed) {
+        const std::size_t size = static_cast<std::size_t>(m_pos - m_flushed);
+        m_failed = !(m_splice ? splice_out(m_flushed, size) : write_out(m_flushed, size));
+        m_bytes += m_failed ? 0 : size;
+    }
+    if (m_splice && !m_failed) {
+        // Spliced pages belong to the pipe now, continue on a fresh page
+        const std::size_t offset = static_cast<std::size_t>(m_pos - m_ring);
+        const std::size_t next = (offset + m_page_size - 1) / m_page_size * m_page_size;
+        m_pos = next < m_capacity ? m_ring + next : m_ring;
+    }
+    else {
+        m_pos = m_ring;
+    }
+    m_flushed = m_pos;
+    return !m_failed;
+}
+
+void Output::make_room()
+{
+    flush();
+    if (static_cast<std::size_t>(m_end - m_pos) < max_value_length) {
+        // Less than a value left before the end of the ring
+        m_pos = m_flushed = m_ring;
+    }
+}
+
+bool Output::write_out(const char * data, const std::size_t size)
+{
+    iovec iov{const_cast<char *>(data), size};
+    return write_fully(m_fd, &iov, 1);
+}
+
+bool Output::splice_out(char * data, std::size_t size)
+{
+#ifdef __linux__
+    const char * const start = data;
+    while (size != 0) {
+        iovec iov{data, size};
+        const ssize_t n = vmsplice(m_fd, &iov, 1, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EINVAL || errno == ENOSYS) && m_bytes == 0 && data == start) {
+                // Not supported here: copy everything instead; nothing
+                // has been spliced, so the ring can be reused at once
+                m_splice = false;
+                return write_out(data, size);
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+#else
+    m_splice = false;
+    return write_out(data, size);
+#endif
+}
+
+bool write_fully(const int fd, iovec * iov, const std::size_t count)
+{
+    // Partial writes resume from the first unwritten byte
+    for (std::size_t first = 0; first < count;) {
+        const ssize_t n = writev(fd, iov + first, static_cast<int>(std::min<std::size_t>(count - first, IOV_MAX)));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        for (std::size_t left = static_cast<std::size_t>(n); left != 0;) {
+            const std::size_t step = std::min(left, iov[first].iov_len);
+            iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + step;
+            iov[first].iov_len -= step;
+            left -= step;
+            if (iov[first].iov_len == 0) {
+                ++first;
+            }
+        }
+        while (first < count && iov[first].iov_len == 0) {
+            ++first;
+        }
+    }
+    return true;
+}
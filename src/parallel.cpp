@@ -0,0 +1,153 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Indices not yet taken by its owner or stolen by other threads
+struct Range
+{
+    std::mutex mutex;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    // NUMA node of the owner
+    std::size_t node = 0;
+};
+
+bool take(Range & range, std::size_t & index)
+{
+    std::lock_guard<std::mutex> lock(range.mutex);
+    if (range.begin == range.end) {
+        return false;
+    }
+    index = range.begin++;
+    return true;
+}
+
+// Moves the upper half of the largest other range into own, preferring the
+// ranges of own node
+bool steal(std::vector<Range> & ranges, Range & own)
+{
+    for (bool local = true;;) {
+        Range * victim = nullptr;
+        std::size_t largest = 0;
+        for (auto & range : ranges) {
+            if (&range == &own || (local && range.node != own.node)) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(range.mutex);
+            if (range.end - range.begin > largest) {
+                largest = range.end - range.begin;
+                victim = &range;
+            }
+        }
+        if (victim == nullptr) {
+            if (!local) {
+                return false;
+            }
+            local = false;
+            continue;
+        }
+        std::size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim->mutex);
+            const std::size_t left = victim->end - victim->begin;
+            if (left == 0) {
+                continue; // taken meanwhile, look again
+            }
+            end = victim->end;
+            begin = end - (left + 1) / 2;
+            victim->end = begin;
+        }
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.begin = begin;
+        own.end = end;
+        return true;
+    }
+}
+
+void work(std::vector<Range> & ranges, Range & own, const std::function<void(std::size_t)> & body)
+{
+    for (;;) {
+        std::size_t index;
+        while (take(own, index)) {
+            body(index);
+        }
+        if (!steal(ranges, own)) {
+            return;
+        }
+    }
+}
+
+} // anonymous namespace
+
+void run_on_nodes(const std::vector<std::size_t> & nodes, const Topology & topology, const std::function<void(std::size_t)> & body)
+{
+    if (nodes.empty()) {
+        return;
+    }
+    const bool pin = topology.nodes() > 1;
+    const auto run = [&](const std::size_t i) {
+        if (pin) {
+            topology.pin(nodes[i]);
+        }
+        body(i);
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(nodes.size() - 1);
+    for (std::size_t i = 1; i < nodes.size(); ++i) {
+        workers.emplace_back(run, i);
+    }
+    cpu_set_t affinity;
+    const bool restore = pin && sched_getaffinity(0, sizeof(affinity), &affinity) == 0;
+    run(0);
+    if (restore) {
+        sched_setaffinity(0, sizeof(affinity), &affinity);
+    }
+    for (auto & worker : workers) {
+        worker.join();
+    }
+}
+
+void parallel_for(const std::size_t count, const unsigned threads, const std::function<void(std::size_t)> & body)
+{
+    parallel_for(count, threads, body, Topology::system());
+}
+
+void parallel_for(const std::size_t count, const unsigned threads, const std::function<void(std::size_t)> & body, const Topology & topology)
+{
+    const std::size_t n = std::max<std::size_t>(1, std::min<std::size_t>(threads, count));
+    std::vector<Range> ranges(n);
+    std::vector<std::size_t> nodes(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        ranges[i].begin = count * i / n;
+        ranges[i].end = count * (i + 1) / n;
+        ranges[i].node = nodes[i] = topology.node_of(i, n);
+    }
+    run_on_nodes(nodes, topology, [&](const std::size_t i) { work(ranges, ranges[i], body); });
+}
+
+void parallel_for_ordered(const std::size_t count, const unsigned threads, const std::function<void(std::size_t)> & body)
+{
+    const std::size_t n = std::max<std::size_t>(1, std::min<std::size_t>(threads, count));
+    std::atomic<std::size_t> next{0};
+    const auto work = [&] {
+        for (std::size_t i; (i = next.fetch_add(1)) < count;) {
+            body(i);
+        }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(n - 1);
+    for (std::size_t i = 1; i < n; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto & worker : workers) {
+        worker.join();
+    }
+}
@@ -0,0 +1,456 @@
+#include "script.h"
+
+#include "cpu_time.h"
+#include "decode.h"
+#include "operators.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <ostream>
+
+namespace calc {
+
+namespace {
+
+using ops::Op;
+
+// Calls and loop runs between checks of the clock
+const std::uint64_t time_check_period = 1024;
+
+bool is_space(const char c)
+{
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+std::string_view trim(std::string_view text)
+{
+    while (!text.empty() && is_space(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && is_space(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// First whitespace separated word of text, advancing pos past it
+std::string_view word(const std::string_view text, std::size_t & pos)
+{
+    while (pos < text.size() && is_space(text[pos])) {
+        ++pos;
+    }
+    const std::size_t begin = pos;
+    while (pos < text.size() && !is_space(text[pos]) && text[pos] != '{' && text[pos] != '}' && text[pos] != ';') {
+        ++pos;
+    }
+    return text.substr(begin, pos - begin);
+}
+
+std::string_view first_word(const std::string_view text)
+{
+    std::size_t pos = 0;
+    return word(text, pos);
+}
+
+bool is_name(const std::string_view name)
+{
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name.front())) != 0) {
+        return false;
+    }
+    for (const char c : name) {
+        if (std::isalnum(static_cast<unsigned char>(c)) == 0 && c != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool is_separator(const char c)
+{
+    return c == ';' || is_space(c);
+}
+
+// Statement text up to the next separator or brace
+std::string_view statement(const std::string_view text, std::size_t & pos)
+{
+    const std::size_t begin = pos;
+    while (pos < text.size() && text[pos] != ';' && text[pos] != '\n' && text[pos] != '{' && text[pos] != '}') {
+        ++pos;
+    }
+    return trim(text.substr(begin, pos - begin));
+}
+
+// Map f followed by map g
+template <class Affine>
+void then(Affine & f, const Affine g)
+{
+    if (g.constant) {
+        f = g;
+        return;
+    }
+    // A constant map only keeps its value, multiplying its a could make a NaN
+    if (!f.constant) {
+        f.a = g.a * f.a;
+    }
+    f.b = g.a * f.b + g.b;
+}
+
+// Same, unless the composition doesn't behave like the maps one by one: a
+// coefficient overflowing to infinity makes NaN (inf * 0) where the steps
+// don't, and an a underflowing to zero or a subnormal from nonzero factors
+// turns an infinite register into NaN and a huge one into 0. f is left as it
+// was then.
+template <class Affine>
+bool then_exact(Affine & f, const Affine g)
+{
+    Affine composed = f;
+    then(composed, g);
+    if (!std::isfinite(composed.a) || !std::isfinite(composed.b)) {
+        return false;
+    }
+    const bool underflow = !composed.constant && !f.constant && f.a != 0 && g.a != 0 && !std::isnormal(composed.a);
+    if (underflow) {
+        return false;
+    }
+    f = composed;
+    return true;
+}
+
+// The map applied n times, by repeated squaring; false if some composition
+// isn't exact (see then_exact), f is unspecified then
+template <class Affine>
+bool power(Affine & f, std::uint64_t n)
+{
+    Affine result;
+    if (f.constant) {
+        // Applying a constant map once or more gives the same constant
+        f = n != 0 ? f : result;
+        return true;
+    }
+    for (; n != 0; n >>= 1) {
+        if ((n & 1) != 0 && !then_exact(result, f)) {
+            return false;
+        }
+        if (n > 1 && !then_exact(f, f)) {
+            return false;
+        }
+    }
+    f = result;
+    return true;
+}
+
+// Composes an operation into an affine map if it is one
+template <class Affine>
+bool affine_map(const Op op, const double * args, const std::size_t count, Affine & f)
+{
+    for (std::size_t k = 0; k < (count != 0 ? count : 1); ++k) {
+        Affine g;
+        switch (op) {
+        case Op::SET: g = {0, args[k], true}; break;
+        case Op::ADD: g = {1, args[k], false}; break;
+        case Op::SUB: g = {1, -args[k], false}; break;
+        case Op::MUL: g = {args[k], 0, false}; break;
+        case Op::DIV:
+            if (args[k] == 0) {
+                return false;
+            }
+            g = {1 / args[k], 0, false};
+            break;
+        case Op::NEG: g = {-1, 0, false}; break;
+        default: return false;
+        }
+        if (!then_exact(f, g)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+Script::Script(const bool affine)
+    : m_affine(affine)
+{
+}
+
+Script::Line Script::feed(Session & session, const std::string_view line, std::ostream & err)
+{
+    if (m_pending.empty()) {
+        const auto keyword = first_word(line);
+        if (keyword != "def" && keyword != "call" && keyword != "repeat") {
+            return Line::Plain;
+        }
+    }
+    // A statement may span lines until its braces are closed
+    m_pending.append(line).push_back('\n');
+    for (const char c : line) {
+        m_depth += c == '{' ? 1 : (c == '}' ? -1 : 0);
+    }
+    if (m_depth > 0) {
+        return Line::Consumed;
+    }
+    const std::string text = std::move(m_pending);
+    m_pending.clear();
+    m_depth = 0;
+
+    if (first_word(text) == "def") {
+        define(text, session.limits().line, err);
+        return Line::Consumed;
+    }
+    // Loop bodies of the statement are only needed while it runs
+    const std::size_t blocks = m_blocks.size();
+    Block block;
+    std::size_t pos = 0;
+    if (session.exhausted()) {
+        diagnostics(err, Status::SessionExhausted) << "Session limit exceeded, line rejected" << std::endl;
+        session.admit(Status::SessionExhausted, 0, std::chrono::nanoseconds(0));
+    }
+    else if (compile(text, pos, block, session.limits().line, 0, err)) {
+        compose(block);
+        const auto allowed = session.time_allowed();
+        Budget budget;
+        budget.timed = allowed.count() != 0;
+        const auto start = budget.timed ? thread_cpu_time() : std::chrono::nanoseconds(0);
+        budget.deadline = start + allowed;
+        double current = session.value();
+        auto status = run(block, current, budget, err);
+        if (status != Status::TimeLimitExceeded) {
+            session.set_value(current);
+        }
+        status = status == Status::TimeLimitExceeded ? status : Status::Ok;
+        session.admit(status, text.size(), budget.timed ? thread_cpu_time() - start : std::chrono::nanoseconds(0));
+    }
+    m_blocks.resize(blocks);
+    return Line::Evaluated;
+}
+
+bool Script::finish(std::ostream & err)
+{
+    if (m_pending.empty()) {
+        return true;
+    }
+    err << "Missing '}'" << std::endl;
+    m_pending.clear();
+    m_depth = 0;
+    return false;
+}
+
+void Script::define(const std::string_view text, const LineLimits & limits, std::ostream & err)
+{
+    std::size_t pos = 0;
+    word(text, pos);
+    const auto name = word(text, pos);
+    if (!is_name(name)) {
+        err << "Bad subroutine name '" << name << "'" << std::endl;
+        return;
+    }
+    while (pos < text.size() && is_space(text[pos])) {
+        ++pos;
+    }
+    if (pos >= text.size() || text[pos] != '{') {
+        err << "Expected '{' after def " << name << std::endl;
+        return;
+    }
+    const std::size_t blocks = m_blocks.size();
+    Block block;
+    ++pos;
+    if (!compile(text, pos, block, limits, 1, err)) {
+        m_blocks.resize(blocks);
+        return;
+    }
+    if (!trim(text.substr(pos)).empty()) {
+        err << "Unexpected text after the body of " << name << ": '" << trim(text.substr(pos)) << "'" << std::endl;
+        m_blocks.resize(blocks);
+        return;
+    }
+    compose(block);
+    m_names[std::string(name)] = m_blocks.size();
+    m_blocks.push_back(std::move(block));
+}
+
+bool Script::compile(const std::string_view text, std::size_t & pos, Block & block, const LineLimits & limits, const std::size_t level, std::ostream & err)
+{
+    const bool nested = level != 0;
+    // Calls and loops recurse at run time, so a bound keeps the stack bounded
+    const auto nest = [&block, &err](const std::size_t depth) {
+        block.depth = std::max(block.depth, depth + 1);
+        if (block.depth > max_nesting) {
+            err << "Calls and loops nested too deep, limit " << max_nesting << std::endl;
+            return false;
+        }
+        return true;
+    };
+    for (;;) {
+        while (pos < text.size() && is_separator(text[pos])) {
+            ++pos;
+        }
+        if (pos >= text.size()) {
+            if (nested) {
+                err << "Missing '}'" << std::endl;
+            }
+            return !nested;
+        }
+        if (text[pos] == '}') {
+            ++pos;
+            if (!nested) {
+                err << "Unexpected '}'" << std::endl;
+            }
+            return nested;
+        }
+        if (text[pos] == '{') {
+            err << "Unexpected '{'" << std::endl;
+            return false;
+        }
+
+        const auto line = statement(text, pos);
+        const auto keyword = first_word(line);
+        if (keyword == "def") {
+            err << "Definitions can't be nested" << std::endl;
+            return false;
+        }
+        if (keyword == "call") {
+            std::size_t i = 0;
+            word(line, i);
+            const auto name = word(line, i);
+            const auto count = word(line, i);
+            Step step{Step::Kind::Call};
+            const bool counted = count.empty() ||
+                    (count.size() > 1 && count.front() == 'x' &&
+                     std::from_chars(count.data() + 1, count.data() + count.size(), step.times).ptr == count.data() + count.size());
+            if (!counted || !word(line, i).empty()) {
+                err << "Bad call: '" << line << "'" << std::endl;
+                return false;
+            }
+            const auto found = m_names.find(std::string(name));
+            if (found == m_names.end()) {
+                err << "Unknown subroutine '" << name << "'" << std::endl;
+                return false;
+            }
+            step.block = found->second;
+            if (!nest(m_blocks[step.block].depth)) {
+                return false;
+            }
+            block.steps.push_back(step);
+            continue;
+        }
+        if (keyword == "repeat") {
+            // An anonymous block called N times
+            std::size_t i = 0;
+            word(line, i);
+            const auto count = word(line, i);
+            Step step{Step::Kind::Call};
+            const bool counted = !count.empty() &&
+                    std::from_chars(count.data(), count.data() + count.size(), step.times).ptr == count.data() + count.size();
+            if (!counted || !word(line, i).empty()) {
+                err << "Bad repeat: '" << line << "'" << std::endl;
+                return false;
+            }
+            if (pos >= text.size() || text[pos] != '{') {
+                err << "Expected '{' after " << line << std::endl;
+                return false;
+            }
+            if (level > max_nesting) {
+                err << "Calls and loops nested too deep, limit " << max_nesting << std::endl;
+                return false;
+            }
+            Block body;
+            ++pos;
+            if (!compile(text, pos, body, limits, level + 1, err) || !nest(body.depth)) {
+                return false;
+            }
+            compose(body);
+            step.block = m_blocks.size();
+            m_blocks.push_back(std::move(body));
+            block.steps.push_back(step);
+            continue;
+        }
+
+        Op op = Op::ERR;
+        Step step{Step::Kind::Operation};
+        step.first = block.args.size();
+        if (decode(line, op, step.fold, block.args, err) != Status::Ok) {
+            return false;
+        }
+        if (limits.max_arguments != 0 && block.args.size() > limits.max_arguments) {
+            err << "Too many arguments, limit " << limits.max_arguments << std::endl;
+            return false;
+        }
+        step.op = static_cast<unsigned>(op);
+        step.count = block.args.size() - step.first;
+        block.steps.push_back(step);
+    }
+}
+
+void Script::compose(Block & block) const
+{
+    if (!m_affine) {
+        return;
+    }
+    std::vector<Step> steps;
+    // Composes f into the last step unless the composition isn't exact
+    const auto merge = [&steps](const Affine & f) {
+        Affine merged = !steps.empty() && steps.back().kind == Step::Kind::Affine ? steps.back().map : Affine{};
+        if (!then_exact(merged, f)) {
+            return false;
+        }
+        if (steps.empty() || steps.back().kind != Step::Kind::Affine) {
+            steps.emplace_back(Step::Kind::Affine);
+        }
+        steps.back().map = merged;
+        return true;
+    };
+    for (const auto & step : block.steps) {
+        Affine f;
+        bool merged = false;
+        if (step.kind == Step::Kind::Operation && affine_map(static_cast<Op>(step.op), block.args.data() + step.first, step.count, f)) {
+            merged = merge(f);
+        }
+        else if (step.kind == Step::Kind::Call && m_blocks[step.block].affine) {
+            f = m_blocks[step.block].map;
+            merged = power(f, step.times) && merge(f);
+        }
+        if (!merged) {
+            steps.push_back(step);
+        }
+    }
+    block.steps = std::move(steps);
+    block.affine = block.steps.empty() || (block.steps.size() == 1 && block.steps[0].kind == Step::Kind::Affine);
+    if (block.affine && !block.steps.empty()) {
+        block.map = block.steps[0].map;
+    }
+}
+
+Status Script::run(const Block & block, double & current, Budget & budget, std::ostream & err) const
+{
+    auto result = Status::Ok;
+    for (const auto & step : block.steps) {
+        auto status = Status::Ok;
+        switch (step.kind) {
+        case Step::Kind::Operation:
+            status = apply(current, static_cast<Op>(step.op), step.fold, block.args.data() + step.first, step.count, err);
+            break;
+        case Step::Kind::Affine:
+            current = step.map.constant ? step.map.b : step.map.a * current + step.map.b;
+            break;
+        case Step::Kind::Call:
+            for (std::uint64_t i = 0; i < step.times; ++i) {
+                if (budget.timed && ++budget.runs % time_check_period == 0 && thread_cpu_time() > budget.deadline) {
+                    diagnostics(err, Status::TimeLimitExceeded) << "Time limit exceeded after " << budget.runs << " runs" << std::endl;
+                    return Status::TimeLimitExceeded;
+                }
+                const auto status_of_run = run(m_blocks[step.block], current, budget, err);
+                if (status_of_run == Status::TimeLimitExceeded) {
+                    return status_of_run;
+                }
+                status = status == Status::Ok ? status_of_run : status;
+            }
+            break;
+        }
+        result = result == Status::Ok ? status : result;
+    }
+    return result;
+}
+
+} // namespace calc
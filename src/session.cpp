@@ -0,0 +1,106 @@
+#include "session.h"
+
+#include "cpu_time.h"
+
+#include <ostream>
+
+namespace calc {
+
+Session::Session(const Limits & limits, const double initial)
+    : m_limits(limits)
+    , m_current(initial)
+{
+}
+
+Status Session::eval(const std::string_view line, std::ostream & err)
+{
+    return run(line, err, nullptr);
+}
+
+Status Session::eval(const std::string_view line, std::ostream & err, LineInfo & info)
+{
+    info = {};
+    return run(line, err, &info);
+}
+
+Status Session::run(const std::string_view line, std::ostream & err, LineInfo * info)
+{
+    if (exhausted()) {
+        diagnostics(err, Status::SessionExhausted) << "Session limit exceeded, line rejected" << std::endl;
+        return count(Status::SessionExhausted);
+    }
+    const bool timed = m_limits.max_time.count() != 0 || m_limits.line.max_time.count() != 0;
+    const auto start = timed ? thread_cpu_time() : std::chrono::nanoseconds(0);
+    LineInfo unused;
+    LineInfo & described = info != nullptr ? *info : unused;
+    LineLimits limits = m_limits.line;
+    limits.max_time = time_allowed();
+    auto status = Status::Ok;
+    if (m_single) {
+        float current = static_cast<float>(m_current);
+        status = evaluate(current, line, err, limits, described);
+        m_current = current;
+    }
+    else {
+        status = evaluate(m_current, line, err, limits, described);
+    }
+    if (status != Status::LineTooLong) {
+        m_admission.bytes += line.size();
+        if (timed) {
+            m_admission.time += thread_cpu_time() - start;
+        }
+    }
+    return count(status);
+}
+
+Status Session::eval(const std::string_view line)
+{
+    return eval(line, null_stream());
+}
+
+Status Session::reject_too_long(const std::size_t bytes, std::ostream & err)
+{
+    auto & out = diagnostics(err, Status::LineTooLong);
+    out << "Line too long: " << bytes << " bytes";
+    if (m_limits.line.max_bytes != 0) {
+        out << ", limit " << m_limits.line.max_bytes;
+    }
+    out << std::endl;
+    return count(Status::LineTooLong);
+}
+
+bool Session::exhausted() const
+{
+    return (m_limits.max_bytes != 0 && m_admission.bytes >= m_limits.max_bytes) ||
+            (m_limits.max_time.count() != 0 && m_admission.time >= m_limits.max_time);
+}
+
+std::chrono::nanoseconds Session::time_allowed() const
+{
+    const auto left = m_limits.max_time - m_admission.time;
+    if (m_limits.max_time.count() != 0 && (m_limits.line.max_time.count() == 0 || left < m_limits.line.max_time)) {
+        return left;
+    }
+    return m_limits.line.max_time;
+}
+
+Status Session::admit(const Status status, const std::size_t bytes, const std::chrono::nanoseconds time)
+{
+    m_admission.bytes += bytes;
+    m_admission.time += time;
+    return count(status);
+}
+
+Status Session::count(const Status status)
+{
+    switch (status) {
+    case Status::LineTooLong: ++m_admission.rejected_too_long; break;
+    case Status::TooManyArguments: ++m_admission.aborted_arguments; break;
+    case Status::TimeLimitExceeded: ++m_admission.aborted_time; break;
+    case Status::SessionExhausted: ++m_admission.rejected_session; break;
+    default: ++m_admission.admitted; break;
+    }
+    return status;
+}
+
+} // namespace calc
@@ -0,0 +1,110 @@
+#include "topology.h"
+
+#include <charconv>
+#include <fstream>
+#include <sched.h>
+#include <string>
+
+namespace {
+
+std::string read_line(const std::string & path)
+{
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+} // anonymous namespace
+
+Topology::Topology(std::vector<std::vector<int>> nodes)
+{
+    for (auto & cpus : nodes) {
+        if (!cpus.empty()) {
+            m_nodes.push_back(std::move(cpus));
+        }
+    }
+    if (m_nodes.empty()) {
+        m_nodes.push_back({0});
+    }
+}
+
+const Topology & Topology::system()
+{
+    static const Topology topology = [] {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                CPU_SET(cpu, &allowed);
+            }
+        }
+        std::vector<std::vector<int>> nodes;
+        const std::string root = "/sys/devices/system/node/";
+        for (const int node : parse_cpulist(read_line(root + "online"))) {
+            std::vector<int> cpus;
+            for (const int cpu : parse_cpulist(read_line(root + "node" + std::to_string(node) + "/cpulist"))) {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                    cpus.push_back(cpu);
+                }
+            }
+            nodes.push_back(std::move(cpus));
+        }
+        std::vector<int> all;
+        for (const auto & cpus : nodes) {
+            all.insert(all.end(), cpus.begin(), cpus.end());
+        }
+        if (all.empty()) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed)) {
+                    all.push_back(cpu);
+                }
+            }
+            nodes = {all};
+        }
+        return Topology(std::move(nodes));
+    }();
+    return topology;
+}
+
+std::vector<int> Topology::parse_cpulist(const std::string_view text)
+{
+    std::vector<int> cpus;
+    const char * pos = text.data();
+    const char * const end = text.data() + text.size();
+    while (pos != end) {
+        int first = 0, last = 0;
+        auto parsed = std::from_chars(pos, end, first);
+        if (parsed.ec != std::errc() || first < 0) {
+            return {};
+        }
+        last = first;
+        pos = parsed.ptr;
+        if (pos != end && *pos == '-') {
+            parsed = std::from_chars(pos + 1, end, last);
+            if (parsed.ec != std::errc() || last < first) {
+                return {};
+            }
+            pos = parsed.ptr;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+        if (pos != end && *pos++ != ',') {
+            return {};
+        }
+    }
+    return cpus;
+}
+
+bool Topology::pin(const std::size_t node) const
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const int cpu : m_nodes[node]) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
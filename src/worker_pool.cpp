@@ -0,0 +1,64 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(const unsigned threads)
+{
+    sem_init(&m_ready, 0, 0);
+    const unsigned n = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    m_threads.reserve(n);
+    for (unsigned i = 0; i < n; ++i) {
+        m_threads.emplace_back(&WorkerPool::work, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    for (std::size_t i = 0; i < m_threads.size(); ++i) {
+        sem_post(&m_ready);
+    }
+    for (auto & thread : m_threads) {
+        thread.join();
+    }
+    sem_destroy(&m_ready);
+}
+
+void WorkerPool::submit(Task & task)
+{
+    task.next = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_tail != nullptr) {
+            m_tail->next = &task;
+        }
+        else {
+            m_head = &task;
+        }
+        m_tail = &task;
+    }
+    sem_post(&m_ready);
+}
+
+void WorkerPool::work()
+{
+    for (;;) {
+        while (sem_wait(&m_ready) != 0) {
+            // Interrupted by a signal
+        }
+        Task * task = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            // Queued tasks are drained before the shutdown wake-ups
+            if (m_head == nullptr) {
+                return;
+            }
+            task = m_head;
+            m_head = task->next;
+            if (m_head == nullptr) {
+                m_tail = nullptr;
+            }
+        }
+        // The task may be destroyed by its own run, don't touch it afterwards
+        task->run(*task);
+    }
+}
@@ -0,0 +1,77 @@
+#include "calc_async.h"
+
+#include <gtest/gtest.h>
+
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Minimal eager coroutine reporting its result through a promise
+struct Task
+{
+    struct promise_type
+    {
+        std::promise<calc::Status> result;
+
+        Task get_return_object() { return {result.get_future()}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_value(const calc::Status status) { result.set_value(status); }
+        void unhandled_exception() { result.set_exception(std::current_exception()); }
+    };
+
+    std::future<calc::Status> status;
+};
+
+// The line is taken by value: it must outlive the suspension
+Task eval(const calc::AsyncEvaluator & calc, double & current, const std::string line, std::thread::id & resumed_on)
+{
+    const auto status = co_await calc.eval_async(current, line);
+    resumed_on = std::this_thread::get_id();
+    co_return status;
+}
+
+std::string long_fold(const std::size_t args)
+{
+    std::string line = "(+)";
+    for (std::size_t i = 0; i < args; ++i) {
+        line += " 1";
+    }
+    return line;
+}
+
+} // anonymous namespace
+
+TEST(Async, small_lines_complete_inline)
+{
+    WorkerPool pool(1);
+    const calc::AsyncEvaluator calc(pool);
+    double current = 1;
+    std::thread::id resumed_on;
+    auto task = eval(calc, current, "(+) 1 2", resumed_on);
+    ASSERT_EQ(std::future_status::ready, task.status.wait_for(std::chrono::seconds(0)));
+    EXPECT_EQ(calc::Status::Ok, task.status.get());
+    EXPECT_EQ(4, current);
+    EXPECT_EQ(std::this_thread::get_id(), resumed_on);
+}
+
+TEST(Async, large_folds_are_offloaded)
+{
+    WorkerPool pool(2);
+    const calc::AsyncEvaluator calc(pool, 16);
+    double current = 0;
+    std::thread::id resumed_on;
+    const auto line = long_fold(100000);
+    auto task = eval(calc, current, line, resumed_on);
+    EXPECT_EQ(calc::Status::Ok, task.status.get());
+    EXPECT_EQ(100000, current);
+    EXPECT_NE(std::this_thread::get_id(), resumed_on);
+
+    auto failed = eval(calc, current, line + " 1x", resumed_on);
+    EXPECT_EQ(calc::Status::BadArgument, failed.status.get());
+    EXPECT_EQ(100000, current);
+}
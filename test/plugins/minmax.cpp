@@ -0,0 +1,52 @@
+// Sample operator plugin used by the unit tests: MIN, MAX and LN
+#include "calc_plugin.h"
+
+#include <cmath>
+
+namespace {
+
+int min(double * left, const double right)
+{
+    *left = std::fmin(*left, right);
+    return 0;
+}
+
+int max(double * left, const double right)
+{
+    *left = std::fmax(*left, right);
+    return 0;
+}
+
+int max_fold(double * acc, const double * args, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        *acc = std::fmax(*acc, args[i]);
+    }
+    return 0;
+}
+
+int ln(double * left, double)
+{
+    if (!(*left > 0)) {
+        return 1;
+    }
+    *left = std::log(*left);
+    return 0;
+}
+
+} // anonymous namespace
+
+extern "C" CALC_API int calc_fold_plugin_init(const calc_register_operator_fn register_operator)
+{
+    const calc_operator ops[] = {
+            {"MIN", 2, min, nullptr, 1, 0, 0},
+            {"MAX", 2, max, max_fold, 1, 0, 0},
+            {"LN", 1, ln, nullptr, 0, 0, 0},
+    };
+    for (const auto & op : ops) {
+        if (const int res = register_operator(&op); res != CALC_PLUGIN_OK) {
+            return res;
+        }
+    }
+    return CALC_PLUGIN_OK;
+}
@@ -0,0 +1,130 @@
+#include "arena.h"
+#include "line_reader.h"
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Feeds text through a pipe and collects all lines read from it
+struct Line
+{
+    std::string text;
+    std::size_t skipped;
+};
+
+std::vector<Line> read_lines(const std::string & text, const std::size_t max_line_bytes, const std::size_t block_size)
+{
+    int fds[2];
+    EXPECT_EQ(0, pipe(fds));
+    std::thread writer([&text, fd = fds[1]] {
+        EXPECT_EQ(static_cast<ssize_t>(text.size()), write(fd, text.data(), text.size()));
+        close(fd);
+    });
+    LineReader reader(fds[0], max_line_bytes, block_size);
+    std::vector<Line> lines;
+    for (LineReader::Batch batch; reader.next(batch);) {
+        for (std::size_t i = 0; i < batch.size; ++i) {
+            lines.push_back({std::string(batch.lines[i].text), batch.lines[i].skipped});
+        }
+    }
+    EXPECT_EQ(0, reader.error());
+    writer.join();
+    close(fds[0]);
+    return lines;
+}
+
+} // anonymous namespace
+
+TEST(Arena, alignment)
+{
+    Arena arena(64);
+    arena.allocate(1, 1);
+    const auto * d = arena.allocate_array<double>(2);
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(d) % alignof(double));
+    const auto * big = arena.allocate(32, 32);
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(big) % 32);
+}
+
+TEST(Arena, reset_reuses_chunks)
+{
+    Arena arena(128);
+    void * first = arena.allocate(100);
+    arena.allocate(100);
+    arena.allocate(1000);
+    const auto capacity = arena.capacity();
+    const auto peak = arena.peak();
+    EXPECT_GE(peak, 1200);
+    arena.reset();
+    EXPECT_EQ(0, arena.used());
+    EXPECT_EQ(first, arena.allocate(100));
+    arena.allocate(100);
+    arena.allocate(1000);
+    EXPECT_EQ(capacity, arena.capacity());
+    EXPECT_EQ(peak, arena.peak());
+}
+
+TEST(Arena, scope)
+{
+    Arena arena(256);
+    arena.allocate(10);
+    const auto used = arena.used();
+    {
+        const Arena::Scope scope(arena);
+        arena.allocate(1000);
+        EXPECT_GT(arena.used(), used);
+    }
+    EXPECT_EQ(used, arena.used());
+}
+
+TEST(LineReader, lines)
+{
+    const auto lines = read_lines("+ 1\n(+) 1 2 3\n\n_", 0, 4);
+    ASSERT_EQ(4, lines.size());
+    EXPECT_EQ("+ 1", lines[0].text);
+    EXPECT_EQ("(+) 1 2 3", lines[1].text);
+    EXPECT_EQ("", lines[2].text);
+    EXPECT_EQ("_", lines[3].text);
+}
+
+TEST(LineReader, read_error)
+{
+    LineReader reader(-1);
+    LineReader::Batch batch;
+    EXPECT_FALSE(reader.next(batch));
+    EXPECT_EQ(EBADF, reader.error());
+}
+
+TEST(LineReader, trailing_newline)
+{
+    const auto lines = read_lines("1\n2\n", 0, 3);
+    ASSERT_EQ(2, lines.size());
+    EXPECT_EQ("2", lines[1].text);
+}
+
+TEST(LineReader, long_lines)
+{
+    const std::string fold = "(+)" + std::string(100000, ' ') + "1";
+    const auto lines = read_lines(fold + "\n" + fold, 0, 16);
+    ASSERT_EQ(2, lines.size());
+    EXPECT_EQ(fold, lines[0].text);
+    EXPECT_EQ(fold, lines[1].text);
+}
+
+TEST(LineReader, skipped)
+{
+    const auto lines = read_lines("+ 1\n+ 123456789\n+ 2\n+ 1234", 5, 4);
+    ASSERT_EQ(4, lines.size());
+    EXPECT_EQ("+ 1", lines[0].text);
+    EXPECT_EQ(0, lines[0].skipped);
+    EXPECT_EQ("", lines[1].text);
+    EXPECT_EQ(11, lines[1].skipped);
+    EXPECT_EQ("+ 2", lines[2].text);
+    EXPECT_EQ(6, lines[3].skipped);
+}
@@ -0,0 +1,130 @@
+#include "batch.h"
+#include "calc_fold.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+TEST(Batch, matches_scalar_engine)
+{
+    const char * const lines[] = {"+ 1", "- 2.5", "* 3", "/ 4", "/ 0", "% 3", "% 0", "^ 2", "_", "SQRT", "17", "(+) 1 2", "fix", "+", "SQRT 1", "(/) 2 0"};
+    std::mt19937 rng(1);
+    std::vector<std::string_view> batch;
+    std::vector<double> registers;
+    for (std::size_t i = 0; i < 1000; ++i) {
+        batch.push_back(lines[rng() % std::size(lines)]);
+        registers.push_back(static_cast<double>(rng() % 200) - 100);
+    }
+    auto expected = registers;
+    std::vector<calc::Status> expected_statuses;
+    std::size_t expected_failed = 0;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        expected_statuses.push_back(calc::evaluate(expected[i], batch[i]));
+        expected_failed += expected_statuses.back() != calc::Status::Ok ? 1 : 0;
+    }
+
+    std::vector<calc::Status> statuses(batch.size());
+    EXPECT_EQ(expected_failed, calc::evaluate_batch(registers.data(), batch.data(), batch.size(), statuses.data()));
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        EXPECT_EQ(expected[i], registers[i]) << i << ": " << batch[i];
+        EXPECT_EQ(expected_statuses[i], statuses[i]) << i << ": " << batch[i];
+    }
+}
+
+TEST(Batch, failed_lanes_keep_register)
+{
+    double registers[] = {5, 6, -7, 0};
+    const std::string_view lines[] = {"/ 0", "% 0", "SQRT", "SQRT"};
+    calc::Status statuses[4];
+    EXPECT_EQ(4, calc::evaluate_batch(registers, lines, 4, statuses));
+    EXPECT_EQ(5, registers[0]);
+    EXPECT_EQ(6, registers[1]);
+    EXPECT_EQ(-7, registers[2]);
+    EXPECT_EQ(0, registers[3]);
+    EXPECT_EQ(calc::Status::DivisionByZero, statuses[0]);
+    EXPECT_EQ(calc::Status::RemainderByZero, statuses[1]);
+    EXPECT_EQ(calc::Status::BadSqrt, statuses[2]);
+}
+
+TEST(Batch, c_api)
+{
+    double registers[] = {1, 4, 2};
+    const calc_line lines[] = {{"+ 1", 3}, {"SQRT", 4}, {"/ 0", 3}};
+    calc_status statuses[3];
+    EXPECT_EQ(1, calc_eval_independent(registers, lines, 3, statuses));
+    EXPECT_EQ(2, registers[0]);
+    EXPECT_EQ(2, registers[1]);
+    EXPECT_EQ(2, registers[2]);
+    EXPECT_EQ(CALC_DIVISION_BY_ZERO, statuses[2]);
+    EXPECT_EQ(0, calc_eval_independent(registers, lines, 0, nullptr));
+}
+
+TEST(Batch, sqrt_error_bitmap)
+{
+    std::vector<double> registers(130, 4);
+    registers[0] = -1;
+    registers[63] = 0;
+    registers[64] = std::nan("");
+    registers[129] = -0.0;
+    std::vector<std::uint64_t> errors(calc::error_words(registers.size()));
+    EXPECT_EQ(3, errors.size());
+    EXPECT_EQ(4, calc::sqrt_batch(registers.data(), registers.size(), errors.data()));
+    EXPECT_EQ(1 | (std::uint64_t{1} << 63), errors[0]);
+    EXPECT_EQ(1, errors[1]);
+    EXPECT_EQ(2, errors[2]);
+    EXPECT_EQ(-1, registers[0]);
+    EXPECT_EQ(0, registers[63]);
+    EXPECT_TRUE(std::isnan(registers[64]));
+    EXPECT_EQ(2, registers[1]);
+    EXPECT_EQ(2, registers[128]);
+}
+
+TEST(Batch, unary_matches_scalar_engine)
+{
+    std::mt19937 rng(2);
+    std::vector<double> registers;
+    for (std::size_t i = 0; i < 1000; ++i) {
+        registers.push_back(std::uniform_real_distribution<double>(-10, 1e10)(rng));
+    }
+    auto roots = registers;
+    calc::sqrt_batch(roots.data(), roots.size(), nullptr);
+    auto negated = registers;
+    calc_neg_batch(negated.data(), negated.size());
+    for (std::size_t i = 0; i < registers.size(); ++i) {
+        double root = registers[i];
+        calc::evaluate(root, "SQRT");
+        EXPECT_EQ(root, roots[i]);
+        double negation = registers[i];
+        calc::evaluate(negation, "_");
+        EXPECT_EQ(negation, negated[i]);
+    }
+}
+
+TEST(Batch, repeated_divisor)
+{
+    // Long runs of one divisor go through calc::Divisor
+    const char * const lines[] = {"/ 3", "/ 0.1", "/ 8", "% 7", "% 0.25", "% 1.1", "/ 0"};
+    std::mt19937 rng(1);
+    std::vector<std::string_view> batch;
+    std::vector<double> registers;
+    for (const auto * line : lines) {
+        for (std::size_t i = 0; i < 100; ++i) {
+            batch.push_back(line);
+            registers.push_back((static_cast<double>(rng()) - 2147483648.0) / (i % 2 == 0 ? 1 : 1000));
+        }
+    }
+    auto expected = registers;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        calc::evaluate(expected[i], batch[i]);
+    }
+    calc::evaluate_batch(registers.data(), batch.data(), batch.size(), nullptr);
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        EXPECT_EQ(0, std::memcmp(&expected[i], &registers[i], sizeof(double))) << i << ": " << batch[i];
+    }
+}
@@ -0,0 +1,109 @@
+#include "calc_fold.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+calc_status eval(calc_handle * handle, const char * line)
+{
+    return calc_eval(handle, line, std::strlen(line));
+}
+
+} // anonymous namespace
+
+TEST(CApi, eval)
+{
+    calc_handle * handle = calc_create(1);
+    ASSERT_NE(nullptr, handle);
+    EXPECT_EQ(CALC_OK, eval(handle, "(+) 1 2 3"));
+    EXPECT_DOUBLE_EQ(7, calc_value(handle));
+    EXPECT_EQ(CALC_UNKNOWN_OPERATION, eval(handle, "fix"));
+    EXPECT_EQ(CALC_BAD_FOLD, eval(handle, "(+ 1"));
+    EXPECT_EQ(CALC_BAD_ARGUMENT, eval(handle, "+ 1 2"));
+    EXPECT_EQ(CALC_ARGUMENT_TOO_LONG, eval(handle, "+ 12345678900000"));
+    EXPECT_EQ(CALC_MISSING_ARGUMENT, eval(handle, "+"));
+    EXPECT_EQ(CALC_UNARY_SUFFIX, eval(handle, "_1"));
+    EXPECT_EQ(CALC_DIVISION_BY_ZERO, eval(handle, "/ 0"));
+    EXPECT_EQ(CALC_REMAINDER_BY_ZERO, eval(handle, "% 0"));
+    EXPECT_DOUBLE_EQ(7, calc_value(handle));
+    calc_set_value(handle, -4);
+    EXPECT_EQ(CALC_BAD_SQRT, eval(handle, "SQRT"));
+    EXPECT_DOUBLE_EQ(-4, calc_value(handle));
+    calc_destroy(handle);
+}
+
+TEST(CApi, no_copy)
+{
+    // Lines are (pointer, length) pairs, so they need not be terminated
+    const char text[] = "+ 12|garbage";
+    calc_handle * handle = calc_create(0);
+    EXPECT_EQ(CALC_OK, calc_eval(handle, text, 4));
+    EXPECT_DOUBLE_EQ(12, calc_value(handle));
+    calc_destroy(handle);
+}
+
+TEST(CApi, batch)
+{
+    const std::vector<std::string> source = {"+ 1", "* 10", "/ 0", "_"};
+    std::vector<calc_line> lines;
+    for (const auto & line : source) {
+        lines.push_back({line.data(), line.size()});
+    }
+    std::vector<double> results(lines.size());
+    std::vector<calc_status> statuses(lines.size());
+    calc_handle * handle = calc_create(1);
+    EXPECT_EQ(1, calc_eval_batch(handle, lines.data(), lines.size(), results.data(), statuses.data()));
+    EXPECT_EQ((std::vector<double>{2, 20, 20, -20}), results);
+    EXPECT_EQ((std::vector<calc_status>{CALC_OK, CALC_OK, CALC_DIVISION_BY_ZERO, CALC_OK}), statuses);
+    EXPECT_DOUBLE_EQ(-20, calc_value(handle));
+    EXPECT_EQ(0, calc_eval_batch(handle, lines.data(), 2, nullptr, nullptr));
+    EXPECT_DOUBLE_EQ(-190, calc_value(handle));
+    calc_destroy(handle);
+}
+
+TEST(CApi, text)
+{
+    const std::string text = "+ 1\n* 10\n/ 0\n_";
+    double results[8];
+    calc_status statuses[8];
+    std::size_t evaluated = 0;
+    calc_handle * handle = calc_create(1);
+    EXPECT_EQ(0, calc_eval_text(handle, text.data(), text.size(), results, statuses, 2, &evaluated));
+    EXPECT_EQ(2, evaluated);
+    EXPECT_DOUBLE_EQ(20, calc_value(handle));
+    EXPECT_EQ(1, calc_eval_text(handle, text.data(), text.size(), results, statuses, 8, &evaluated));
+    EXPECT_EQ(4, evaluated);
+    EXPECT_EQ(CALC_DIVISION_BY_ZERO, statuses[2]);
+    EXPECT_DOUBLE_EQ(-210, results[3]);
+    calc_destroy(handle);
+}
+
+TEST(CApi, bad_handle)
+{
+    EXPECT_EQ(CALC_BAD_HANDLE, eval(nullptr, "+ 1"));
+    EXPECT_EQ(1, calc_eval_batch(nullptr, nullptr, 1, nullptr, nullptr));
+}
+
+TEST(CApi, limits)
+{
+    calc_handle * handle = calc_create(0);
+    calc_limits limits = {};
+    limits.max_line_bytes = 10;
+    limits.max_arguments = 2;
+    calc_set_limits(handle, &limits);
+    EXPECT_EQ(CALC_OK, eval(handle, "(+) 1 2"));
+    EXPECT_EQ(CALC_TOO_MANY_ARGUMENTS, eval(handle, "(+) 1 2 3"));
+    EXPECT_EQ(CALC_LINE_TOO_LONG, eval(handle, "(+) 1 2 3 4"));
+    EXPECT_DOUBLE_EQ(3, calc_value(handle));
+    calc_admission admission = {};
+    calc_get_admission(handle, &admission);
+    EXPECT_EQ(1, admission.admitted);
+    EXPECT_EQ(1, admission.aborted_arguments);
+    EXPECT_EQ(1, admission.rejected_too_long);
+    EXPECT_EQ(16, admission.bytes);
+    calc_destroy(handle);
+}
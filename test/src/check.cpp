@@ -0,0 +1,73 @@
+#include "calc.h"
+#include "check.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+TEST(Check, valid)
+{
+    std::ostringstream err;
+    EXPECT_TRUE(check_line("+ 1", err));
+    EXPECT_TRUE(check_line("(^) 1 2 3", err));
+    EXPECT_TRUE(check_line("(-)1 1 2 3 5 ", err));
+    EXPECT_TRUE(check_line("_", err));
+    EXPECT_TRUE(check_line("SQRT", err));
+    EXPECT_TRUE(check_line("0.05625", err));
+    EXPECT_EQ("", err.str());
+}
+
+TEST(Check, invalid)
+{
+    std::ostringstream err;
+    EXPECT_FALSE(check_line("fix", err));
+    EXPECT_EQ("Unknown operation fix\n", err.str());
+    err.str({});
+    EXPECT_FALSE(check_line("+ 1 2", err));
+    EXPECT_EQ("Argument parsing error at 3: ' 2'\n", err.str());
+    err.str({});
+    EXPECT_FALSE(check_line("+    12345678900000", err));
+    EXPECT_EQ("Argument isn't fully parsed, suffix left: '0000'\n", err.str());
+    err.str({});
+    EXPECT_FALSE(check_line("_1", err));
+    EXPECT_EQ("Unexpected suffix for a unary operation: '1'\n", err.str());
+    err.str({});
+    EXPECT_FALSE(check_line("(/) 1 0", err));
+    EXPECT_EQ("Bad right argument for division: 0\n", err.str());
+    err.str({});
+    EXPECT_FALSE(check_line("((+) 1 2 3", err));
+    EXPECT_FALSE(check_line("", err));
+}
+
+TEST(Check, no_evaluation)
+{
+    // SQRT validity depends on the register value, so it is not checked
+    std::ostringstream err;
+    EXPECT_TRUE(check_line("SQRT", err));
+    EXPECT_EQ("", err.str());
+}
+
+TEST(Check, text_order)
+{
+    std::string text;
+    for (int i = 0; i < 300000; ++i) {
+        text += i % 100000 == 7 ? "+ x\n" : "(+) 1 2 3\n";
+    }
+    std::ostringstream err;
+    EXPECT_EQ(3, check_text(text, "in", 4, err));
+    EXPECT_EQ("in:8: Argument parsing error at 2: 'x'\n"
+              "in:8: No argument for a binary operation\n"
+              "in:100008: Argument parsing error at 2: 'x'\n"
+              "in:100008: No argument for a binary operation\n"
+              "in:200008: Argument parsing error at 2: 'x'\n"
+              "in:200008: No argument for a binary operation\n",
+              err.str());
+}
+
+TEST(Check, text_last_line)
+{
+    std::ostringstream err;
+    EXPECT_EQ(1, check_text("+ 1\n* 2\n/ 0", "f", 1, err));
+    EXPECT_EQ("f:3: Bad right argument for division: 0\n", err.str());
+}
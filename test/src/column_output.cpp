@@ -0,0 +1,152 @@
+#include "column_output.h"
+#include "session.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Row
+{
+    std::uint64_t line;
+    double result;
+    std::uint32_t arguments;
+    std::uint16_t op;
+    std::uint16_t status;
+};
+
+std::size_t aligned(const std::size_t size)
+{
+    return (size + column_alignment - 1) / column_alignment * column_alignment;
+}
+
+template <class T>
+T read_at(const std::string & data, const std::size_t offset)
+{
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
+
+// Reads a column file back, checking its layout
+std::vector<Row> read_columns(const std::string & path, std::size_t & batches)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    const std::string data = buffer.str();
+
+    std::vector<Row> rows;
+    batches = 0;
+    EXPECT_LE(sizeof(ColumnFileHeader), data.size());
+    const auto header = read_at<ColumnFileHeader>(data, 0);
+    EXPECT_STREQ("CALCCOL", header.magic);
+    EXPECT_EQ(1, header.version);
+    EXPECT_EQ(0x01020304, header.byte_order);
+    EXPECT_EQ(5, header.columns);
+    EXPECT_EQ(column_alignment, header.alignment);
+    for (std::size_t offset = sizeof(header); offset < data.size();) {
+        EXPECT_EQ(0, offset % column_alignment);
+        const auto batch = read_at<ColumnBatchHeader>(data, offset);
+        offset += sizeof(batch);
+        if (batch.rows == 0) {
+            EXPECT_EQ(data.size(), offset);
+            return rows;
+        }
+        ++batches;
+        EXPECT_LE(batch.rows, header.batch_rows);
+        const std::size_t n = batch.rows;
+        const std::size_t line = offset;
+        const std::size_t result = line + aligned(n * 8);
+        const std::size_t arguments = result + aligned(n * 8);
+        const std::size_t op = arguments + aligned(n * 4);
+        const std::size_t status = op + aligned(n * 2);
+        offset = status + aligned(n * 2);
+        for (std::size_t i = 0; i < n; ++i) {
+            rows.push_back({read_at<std::uint64_t>(data, line + 8 * i),
+                    read_at<double>(data, result + 8 * i),
+                    read_at<std::uint32_t>(data, arguments + 4 * i),
+                    read_at<std::uint16_t>(data, op + 2 * i),
+                    read_at<std::uint16_t>(data, status + 2 * i)});
+        }
+        EXPECT_EQ(batch.first_line, rows[rows.size() - n].line);
+    }
+    ADD_FAILURE() << "no end marker";
+    return rows;
+}
+
+} // anonymous namespace
+
+TEST(ColumnOutput, line_info)
+{
+    calc::Session session;
+    calc::LineInfo info;
+    EXPECT_EQ(calc::Status::Ok, session.eval("(+) 1 2 3", calc::null_stream(), info));
+    EXPECT_EQ(2, info.op);
+    EXPECT_EQ(3, info.arguments);
+    EXPECT_EQ(calc::Status::Ok, session.eval("SQRT", calc::null_stream(), info));
+    EXPECT_EQ(9, info.op);
+    EXPECT_EQ(0, info.arguments);
+    EXPECT_EQ(calc::Status::DivisionByZero, session.eval("(/) 2 0 4", calc::null_stream(), info));
+    EXPECT_EQ(5, info.op);
+    EXPECT_EQ(2, info.arguments);
+    EXPECT_EQ(calc::Status::UnknownOperation, session.eval("x", calc::null_stream(), info));
+    EXPECT_EQ(0, info.op);
+    EXPECT_EQ(0, info.arguments);
+}
+
+TEST(ColumnOutput, round_trip)
+{
+    const std::string path = "/tmp/calc_fold_columns_" + std::to_string(getpid());
+    const std::vector<std::string> lines = {"+ 1", "(*) 2 3", "/ 0", "_", "SQRT", "bad", "(-) 1 2 3 4"};
+    const std::size_t count = 1000;
+    std::vector<Row> expected;
+    {
+        const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        ASSERT_LE(0, fd);
+        // Batches of 100 rows leave a partial last batch
+        ColumnOutput output(fd, 100);
+        calc::Session session;
+        for (std::size_t i = 0; i < count; ++i) {
+            calc::LineInfo info;
+            const auto status = session.eval(lines[i % lines.size()], calc::null_stream(), info);
+            output.put(i + 1, session.value(), status, info);
+            expected.push_back({i + 1, session.value(), static_cast<std::uint32_t>(info.arguments), static_cast<std::uint16_t>(info.op), static_cast<std::uint16_t>(status)});
+        }
+        EXPECT_TRUE(output.finish());
+        close(fd);
+    }
+    std::size_t batches = 0;
+    const auto rows = read_columns(path, batches);
+    EXPECT_EQ(10, batches);
+    ASSERT_EQ(expected.size(), rows.size());
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        EXPECT_EQ(expected[i].line, rows[i].line);
+        EXPECT_EQ(0, std::memcmp(&expected[i].result, &rows[i].result, sizeof(double)));
+        EXPECT_EQ(expected[i].arguments, rows[i].arguments);
+        EXPECT_EQ(expected[i].op, rows[i].op);
+        EXPECT_EQ(expected[i].status, rows[i].status);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(ColumnOutput, empty)
+{
+    const std::string path = "/tmp/calc_fold_columns_empty_" + std::to_string(getpid());
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    ASSERT_LE(0, fd);
+    EXPECT_TRUE(ColumnOutput(fd).finish());
+    close(fd);
+    std::size_t batches = 0;
+    EXPECT_TRUE(read_columns(path, batches).empty());
+    EXPECT_EQ(0, batches);
+    std::remove(path.c_str());
+}
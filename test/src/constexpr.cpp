@@ -0,0 +1,106 @@
+#include "calc.h"
+#include "calc_constexpr.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+namespace {
+
+bool same_bits(const double a, const double b)
+{
+    return std::memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+} // anonymous namespace
+
+static_assert(calc::eval(0, "(+) 1 2 3") == 6);
+static_assert(calc::eval(5, "13") == 13);
+static_assert(calc::eval(1024, "(/) 4 8 16") == 2);
+static_assert(calc::eval(15, "(%) 8 5") == 2);
+static_assert(calc::eval(-13, "%5") == -3);
+static_assert(calc::eval(25, "SQRT") == 5);
+static_assert(calc::eval(2, "(^) 2 2 2 2") == 65536);
+static_assert(calc::eval(-1, "_") == 1);
+static_assert(calc::eval(7, "fix") == 7);
+static_assert(calc::eval(11, "/ 0") == 11);
+static_assert(calc::eval(-1, "SQRT") == -1);
+static_assert(calc::eval(1, "12345678900000") == 1);
+static_assert(calc::eval(3, "((+) 1 2 3") == 3);
+static_assert(calc::fold<calc::Op::MUL>(1.0, 2.0, 3.0, 4.0) == 24);
+static_assert(calc::fold<calc::Op::SUB>(10.0, 1, 2) == 7);
+static_assert(calc::fold<calc::Op::DIV>(10.0, 2.0, 0.0) == 10);
+static_assert(calc::fold<calc::Op::POW>(2.0, -3.0) == 0.125);
+// 2^1074 overflows, the result is still the smallest subnormal like std::pow
+static_assert(calc::fold<calc::Op::POW>(2.0, -1074.0) == std::numeric_limits<double>::denorm_min());
+static_assert(calc::fold<calc::Op::POW>(0.5, -1023.0) == 0x1p1023);
+
+TEST(Constexpr, same_as_process_line)
+{
+    const double registers[] = {0, -0.0, 1, -1, 0.49, 2.5, -13, 1e300, std::numeric_limits<double>::infinity()};
+    const char * const lines[] = {
+            "+7",
+            "+ 0.84",
+            "- 12345.67890",
+            "* 4",
+            "/ 3",
+            "/ 0.1",
+            "% 5",
+            "%0.3",
+            "_",
+            "^0.5",
+            "^3",
+            "SQRT",
+            "SQRT ",
+            "0.05625",
+            "5.",
+            "(+) 1 2 34567.8345 9",
+            "(-)1 1 2 3 5 ",
+            "(*)    1          2                             ",
+            "(^) 3 1 1 1",
+            "(/) 12 4 5 0.5",
+            "(%) 123 93 11 4",
+            "(+) 1234567890 1",
+            "(+)",
+            "(S) 5",
+            "+ -",
+            "",
+    };
+    testing::internal::CaptureStderr();
+    for (const double current : registers) {
+        for (const char * line : lines) {
+            EXPECT_TRUE(same_bits(process_line(current, line), calc::eval(current, line))) << current << " '" << line << "'";
+        }
+    }
+    testing::internal::GetCapturedStderr();
+}
+
+TEST(Constexpr, exact_sqrt)
+{
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> exponent(-1070, 1020);
+    for (int i = 0; i < 100000; ++i) {
+        const double x = std::ldexp(1 + std::generate_canonical<double, 64>(rng), static_cast<int>(exponent(rng)));
+        ASSERT_TRUE(same_bits(std::sqrt(x), calc::detail::exact_sqrt(x))) << x;
+    }
+    EXPECT_TRUE(same_bits(std::sqrt(std::numeric_limits<double>::denorm_min()), calc::detail::exact_sqrt(std::numeric_limits<double>::denorm_min())));
+    EXPECT_TRUE(same_bits(std::sqrt(std::numeric_limits<double>::max()), calc::detail::exact_sqrt(std::numeric_limits<double>::max())));
+}
+
+TEST(Constexpr, exact_fmod)
+{
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> value(-1e6, 1e6);
+    std::uniform_int_distribution<int> exponent(-60, 60);
+    for (int i = 0; i < 100000; ++i) {
+        const double x = std::ldexp(value(rng), exponent(rng));
+        const double y = std::ldexp(value(rng), exponent(rng));
+        ASSERT_TRUE(same_bits(std::fmod(x, y), calc::detail::exact_fmod(x, y))) << x << " % " << y;
+    }
+    EXPECT_TRUE(same_bits(std::fmod(-4.0, 2.0), calc::detail::exact_fmod(-4, 2)));
+    EXPECT_TRUE(same_bits(std::fmod(1e308, 3e-308), calc::detail::exact_fmod(1e308, 3e-308)));
+    EXPECT_TRUE(std::isnan(calc::detail::exact_fmod(std::numeric_limits<double>::infinity(), 2)));
+}
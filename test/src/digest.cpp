@@ -0,0 +1,43 @@
+#include "digest.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+
+TEST(Digest, empty)
+{
+    Digest digest;
+    EXPECT_EQ(0, digest.lines());
+    EXPECT_EQ(16 + 2, digest.str().size());
+}
+
+TEST(Digest, order_sensitive)
+{
+    Digest a, b;
+    a.update(1);
+    a.update(2);
+    b.update(2);
+    b.update(1);
+    EXPECT_NE(a.value(), b.value());
+    EXPECT_EQ(2, a.lines());
+}
+
+TEST(Digest, bitwise)
+{
+    Digest a, b, c;
+    a.update(0.0);
+    b.update(-0.0);
+    c.update(0.0);
+    EXPECT_NE(a.value(), b.value());
+    EXPECT_EQ(a.value(), c.value());
+    EXPECT_EQ(a.str(), c.str());
+}
+
+TEST(Digest, length)
+{
+    Digest a, b;
+    a.update(0);
+    b.update(0);
+    b.update(0);
+    EXPECT_NE(a.value(), b.value());
+}
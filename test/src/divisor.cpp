@@ -0,0 +1,58 @@
+#include "divisor.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+bool same_bits(const double a, const double b)
+{
+    return std::memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Dividends of every kind: random bit patterns (including NaN, infinities and
+// subnormals), integers around 2^52, small integers and moderate values
+std::vector<double> dividends(const std::size_t count)
+{
+    std::mt19937_64 rng(1);
+    std::vector<double> result = {0.0, -0.0, INFINITY, -INFINITY, NAN, 0x1p52, 0x1p52 - 1, -0x1p53, 0x1p-1074};
+    while (result.size() < count) {
+        const std::uint64_t bits = rng();
+        double x;
+        switch (result.size() % 4) {
+        case 0: std::memcpy(&x, &bits, sizeof(x)); break;
+        case 1: x = static_cast<double>(bits >> 11) - 0x1p52; break;
+        case 2: x = static_cast<double>(static_cast<std::int32_t>(bits)); break;
+        default: x = std::ldexp(static_cast<double>(bits >> 11) - 0x1p52, static_cast<int>(bits % 300) - 200); break;
+        }
+        result.push_back(x);
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+TEST(Divisor, bit_identical)
+{
+    const double divisors[] = {3, 7, -5, 10, 0.1, 1.1, 4, 0.25, -1024, 1e300, 1e-300, 0x1p-1030, 0x1p1023, 1000000007,
+            0x1p52 - 1, 0x1p52, 1.9999999999999998, std::nextafter(1.0, 0.0), 6.02214076e23, -INFINITY};
+    const auto x = dividends(30000);
+    for (const double d : divisors) {
+        const calc::Divisor divisor(d);
+        std::vector<double> quotients = x;
+        std::vector<double> remainders = x;
+        divisor.divide(quotients.data(), quotients.size());
+        divisor.remainder(remainders.data(), remainders.size());
+        for (std::size_t i = 0; i < x.size(); ++i) {
+            ASSERT_TRUE(same_bits(x[i] / d, divisor.divide(x[i]))) << x[i] << " / " << d;
+            ASSERT_TRUE(same_bits(std::fmod(x[i], d), divisor.remainder(x[i]))) << x[i] << " % " << d;
+            ASSERT_TRUE(same_bits(x[i] / d, quotients[i])) << x[i] << " / " << d;
+            ASSERT_TRUE(same_bits(std::fmod(x[i], d), remainders[i])) << x[i] << " % " << d;
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include "error_report.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+
+TEST(ErrorReport, examples_counts_and_summaries)
+{
+    std::ostringstream err;
+    calc::Session session({}, 1);
+    ErrorReport report(err, 2, 4);
+    for (const auto * line : {"FOO 1", "+ 1", "/ 0", "BAR 2", "+ x", "BAZ 3", "* 3", "/ 0", "/ 0"}) {
+        report.eval(session, line);
+    }
+    report.reject_too_long(session, 100);
+    report.finish();
+    EXPECT_EQ(6, session.value());
+    EXPECT_EQ(8, report.errors());
+    EXPECT_EQ(3, report.count(calc::Status::UnknownOperation));
+    EXPECT_EQ(3, report.count(calc::Status::DivisionByZero));
+    EXPECT_EQ(1, report.count(calc::Status::MissingArgument));
+    EXPECT_EQ(1, report.count(calc::Status::LineTooLong));
+    EXPECT_EQ("Unknown operation FOO 1\n"
+              "Bad right argument for division: 0\n"
+              "Unknown operation BAR 2\n"
+              "Errors so far: 3 in 4 lines (unknown operation 2; division by zero 1)\n"
+              "Argument parsing error at 2: 'x'\n"
+              "No argument for a binary operation\n"
+              "Bad right argument for division: 0\n"
+              "Errors so far: 6 in 8 lines (unknown operation 3, 2 shown; missing argument 1; division by zero 2)\n"
+              "Line too long: 100 bytes\n"
+              "Errors: 8 in 10 lines (unknown operation 3, 2 shown; missing argument 1; division by zero 3, 2 shown; line too long 1)\n",
+            err.str());
+}
+
+TEST(ErrorReport, no_examples)
+{
+    std::ostringstream err;
+    calc::Session session;
+    ErrorReport report(err, 0);
+    calc::LineInfo info;
+    EXPECT_EQ(calc::Status::UnknownOperation, report.eval(session, "FOO", info));
+    EXPECT_EQ(calc::Status::Ok, report.eval(session, "(+) 1 2", info));
+    EXPECT_EQ(2, info.arguments);
+    EXPECT_EQ("", err.str());
+    report.finish();
+    EXPECT_EQ("Errors: 1 in 2 lines (unknown operation 1, 0 shown)\n", err.str());
+}
+
+TEST(ErrorReport, unlimited_examples_print_everything)
+{
+    std::ostringstream err, expected;
+    calc::Session session, plain;
+    ErrorReport report(err, static_cast<std::uint64_t>(-1));
+    for (const auto * line : {"FOO", "+ x", "SQRT 1", "+ 1"}) {
+        report.eval(session, line);
+        plain.eval(line, expected);
+    }
+    EXPECT_EQ(expected.str(), err.str());
+    EXPECT_EQ(plain.value(), session.value());
+}
+
+TEST(ErrorReport, examples_keep_the_text_of_their_evaluation)
+{
+    // A line over the time limit makes an example after another category is
+    // exhausted, its text is the one of its only evaluation
+    calc::Limits limits;
+    limits.line.max_time = std::chrono::nanoseconds(1);
+    std::ostringstream err;
+    calc::Session session(limits, 1);
+    ErrorReport report(err, 1);
+    std::string line = "(+)";
+    for (int i = 0; i < 2000; ++i) {
+        line += " 1";
+    }
+    report.eval(session, "FOO");
+    err.str("");
+    EXPECT_EQ(calc::Status::TimeLimitExceeded, report.eval(session, line));
+    EXPECT_EQ("Time limit exceeded after 1024 arguments\n", err.str());
+    EXPECT_EQ(calc::Status::TimeLimitExceeded, report.eval(session, line));
+    EXPECT_EQ("Time limit exceeded after 1024 arguments\n", err.str());
+    EXPECT_EQ(2u, session.admission().aborted_time);
+    EXPECT_EQ(1, session.value());
+}
+
+namespace {
+
+struct OnlyUnknown : calc::DiagnosticFilter
+{
+    bool wants(const calc::Status status) const override { return status == calc::Status::UnknownOperation; }
+};
+
+} // anonymous namespace
+
+TEST(ErrorReport, diagnostic_filter)
+{
+    // Unwanted diagnostics aren't written, the stream stays usable
+    std::ostringstream err;
+    const OnlyUnknown filter;
+    calc::set_diagnostic_filter(err, &filter);
+    calc::Session session({}, 2);
+    EXPECT_EQ(calc::Status::DivisionByZero, session.eval("/ 0", err));
+    EXPECT_EQ(calc::Status::UnknownOperation, session.eval("FOO", err));
+    EXPECT_EQ(calc::Status::Ok, session.eval("_", err));
+    EXPECT_EQ(calc::Status::BadSqrt, session.eval("SQRT", err));
+    EXPECT_EQ("Unknown operation FOO\n", err.str());
+    EXPECT_TRUE(err.good());
+    calc::set_diagnostic_filter(err, nullptr);
+    session.eval("/ 0", err);
+    EXPECT_EQ("Unknown operation FOO\nBad right argument for division: 0\n", err.str());
+}
@@ -0,0 +1,59 @@
+#include "mapped_output.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+std::string read_file(const std::string & path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+} // anonymous namespace
+
+TEST(MappedOutput, matches_ostream)
+{
+    const std::string path = "/tmp/calc_fold_mapped_" + std::to_string(getpid());
+    std::ostringstream expected;
+    for (const unsigned threads : {1u, 3u}) {
+        expected.str({});
+        {
+            // A small window makes the file grow over many mappings
+            MappedOutput output(path, threads, 1000);
+            ASSERT_TRUE(output.is_open());
+            for (std::size_t i = 0; i < 12345; ++i) {
+                const double value = std::sqrt(static_cast<double>(i)) * (i % 2 == 0 ? 1e5 : -1e-5);
+                output.put(value);
+                expected << value << '\n';
+            }
+            EXPECT_TRUE(output.close());
+        }
+        EXPECT_EQ(expected.str(), read_file(path));
+    }
+    std::remove(path.c_str());
+}
+
+TEST(MappedOutput, empty_and_unwritable)
+{
+    const std::string path = "/tmp/calc_fold_mapped_empty_" + std::to_string(getpid());
+    {
+        MappedOutput output(path, 2);
+        EXPECT_TRUE(output.close());
+    }
+    EXPECT_EQ("", read_file(path));
+    std::remove(path.c_str());
+
+    MappedOutput output("/nonexistent/dir/file", 2);
+    EXPECT_FALSE(output.is_open());
+    EXPECT_FALSE(output.close());
+}
@@ -0,0 +1,99 @@
+#include "ordered_output.h"
+#include "parallel.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+class TempFile
+{
+public:
+    TempFile()
+    {
+        char name[] = "/tmp/calc_fold_ordered_XXXXXX";
+        m_fd = mkstemp(name);
+        m_name = name;
+    }
+    ~TempFile()
+    {
+        close(m_fd);
+        std::remove(m_name.c_str());
+    }
+
+    int fd() const { return m_fd; }
+
+    std::string contents() const
+    {
+        std::ifstream in(m_name, std::ios::binary);
+        std::ostringstream buffer;
+        buffer << in.rdbuf();
+        return buffer.str();
+    }
+
+private:
+    int m_fd;
+    std::string m_name;
+};
+
+std::string piece(const std::size_t segment, const std::size_t n)
+{
+    return std::to_string(segment) + '.' + std::to_string(n) + '\n';
+}
+
+} // anonymous namespace
+
+TEST(OrderedOutput, segments_written_in_order)
+{
+    const std::size_t segments = 200;
+    const std::size_t pieces = 50;
+    TempFile file;
+    {
+        // A tiny window and segment limit make producers wait for the writer
+        OrderedOutput output(file.fd(), 3, 64);
+        parallel_for_ordered(segments, 4, [&](const std::size_t i) {
+            output.begin(i);
+            for (std::size_t n = 0; n < pieces * (i % 3); ++n) {
+                output.write(i, piece(i, n));
+            }
+            output.end(i);
+        });
+        EXPECT_TRUE(output.finish());
+    }
+    std::string expected;
+    for (std::size_t i = 0; i < segments; ++i) {
+        for (std::size_t n = 0; n < pieces * (i % 3); ++n) {
+            expected += piece(i, n);
+        }
+    }
+    EXPECT_EQ(expected, file.contents());
+}
+
+TEST(OrderedOutput, segments_ended_out_of_order)
+{
+    TempFile file;
+    OrderedOutput output(file.fd(), 4);
+    for (std::size_t i = 0; i < 4; ++i) {
+        output.begin(i);
+    }
+    for (std::size_t i = 4; i-- > 0;) {
+        output.write(i, piece(i, 0));
+        output.end(i);
+    }
+    EXPECT_TRUE(output.finish());
+    EXPECT_EQ(piece(0, 0) + piece(1, 0) + piece(2, 0) + piece(3, 0), file.contents());
+}
+
+TEST(OrderedOutput, write_error)
+{
+    OrderedOutput output(-1, 1);
+    output.begin(0);
+    output.write(0, "lost");
+    output.end(0);
+    EXPECT_FALSE(output.finish());
+}
@@ -0,0 +1,115 @@
+#include "output.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+std::vector<double> values()
+{
+    std::vector<double> res = {
+            0,
+            -0.0,
+            1,
+            -2.5,
+            123456,
+            1234567,
+            0.0001,
+            0.00001,
+            1e300,
+            4.9e-324,
+            std::numeric_limits<double>::max(),
+            std::numeric_limits<double>::infinity(),
+            -std::numeric_limits<double>::infinity(),
+            std::numeric_limits<double>::quiet_NaN(),
+            -std::numeric_limits<double>::quiet_NaN()};
+    std::mt19937_64 rng(1);
+    for (std::size_t i = 0; i < 100000; ++i) {
+        res.push_back(std::ldexp(std::uniform_real_distribution<double>(-1, 1)(rng), static_cast<int>(rng() % 200) - 100));
+    }
+    return res;
+}
+
+std::string expected(const std::vector<double> & values)
+{
+    std::ostringstream out;
+    for (const double value : values) {
+        out << value << '\n';
+    }
+    return out.str();
+}
+
+// Writes values through Output into a pipe, flushing every `every` values
+std::string through_pipe(const std::vector<double> & values, const bool splice, const std::size_t every, bool & spliced)
+{
+    int fds[2];
+    EXPECT_EQ(0, pipe(fds));
+    std::string res;
+    std::thread reader([&] {
+        char buffer[4096];
+        for (ssize_t n; (n = read(fds[0], buffer, sizeof(buffer))) > 0;) {
+            res.append(buffer, static_cast<std::size_t>(n));
+        }
+    });
+    {
+        Output output(fds[1], splice);
+        spliced = output.splicing();
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            output.put(values[i]);
+            if (i % every == 0) {
+                output.write("");
+                EXPECT_TRUE(output.flush());
+            }
+        }
+        output.write("end\n");
+    }
+    close(fds[1]);
+    reader.join();
+    close(fds[0]);
+    return res;
+}
+
+} // anonymous namespace
+
+TEST(Output, formats_like_ostream)
+{
+    const auto input = values();
+    const auto reference = expected(input) + "end\n";
+    for (const bool splice : {false, true}) {
+        for (const std::size_t every : {1, 777, 1000000}) {
+            bool spliced = false;
+            EXPECT_EQ(reference, through_pipe(input, splice, every, spliced)) << splice << ' ' << every;
+            if (!splice) {
+                EXPECT_FALSE(spliced);
+            }
+        }
+    }
+}
+
+TEST(Output, regular_file)
+{
+    std::FILE * file = std::tmpfile();
+    ASSERT_NE(nullptr, file);
+    {
+        Output output(fileno(file));
+        EXPECT_FALSE(output.splicing());
+        output.put(1.5);
+        output.write("x\n");
+        EXPECT_TRUE(output.flush());
+        EXPECT_EQ(6, output.bytes());
+    }
+    std::rewind(file);
+    char buffer[16] = {};
+    EXPECT_EQ(6, std::fread(buffer, 1, sizeof(buffer), file));
+    EXPECT_EQ(std::string("1.5\nx\n"), buffer);
+    std::fclose(file);
+}
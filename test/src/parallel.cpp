@@ -0,0 +1,96 @@
+#include "parallel.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(ParallelFor, runs_every_index_once)
+{
+    for (const unsigned threads : {1u, 3u, 8u}) {
+        std::vector<std::atomic<int>> runs(1000);
+        parallel_for(runs.size(), threads, [&](const std::size_t i) {
+            // Uneven jobs: the first ones are much longer
+            if (i < 10) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+            ++runs[i];
+        });
+        for (const auto & count : runs) {
+            EXPECT_EQ(1, count);
+        }
+    }
+}
+
+TEST(ParallelFor, few_jobs)
+{
+    std::atomic<int> runs{0};
+    parallel_for(0, 4, [&](std::size_t) { ++runs; });
+    EXPECT_EQ(0, runs);
+    parallel_for(2, 16, [&](std::size_t) { ++runs; });
+    EXPECT_EQ(2, runs);
+}
+
+namespace {
+
+// Two nodes sharing the CPUs of this machine, so that pinning works anywhere
+Topology two_nodes()
+{
+    const auto & system = Topology::system();
+    return Topology({system.cpus(0), system.cpus(0)});
+}
+
+} // anonymous namespace
+
+TEST(Topology, parse_cpulist)
+{
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 8, 10, 11}), Topology::parse_cpulist("0-3,8,10-11"));
+    EXPECT_EQ((std::vector<int>{5}), Topology::parse_cpulist("5"));
+    EXPECT_TRUE(Topology::parse_cpulist("").empty());
+    EXPECT_TRUE(Topology::parse_cpulist("3-1").empty());
+    EXPECT_TRUE(Topology::parse_cpulist("1,x").empty());
+}
+
+TEST(Topology, workers_in_blocks)
+{
+    const Topology topology({{0}, {}, {1}, {2}});
+    EXPECT_EQ(3, topology.nodes());
+    const std::vector<std::size_t> expected = {0, 0, 0, 1, 1, 2, 2};
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i], topology.node_of(i, expected.size())) << i;
+    }
+    EXPECT_LE(1, Topology::system().nodes());
+    EXPECT_FALSE(Topology::system().cpus(0).empty());
+}
+
+TEST(ParallelFor, pinned_to_nodes)
+{
+    std::vector<std::atomic<int>> runs(1000);
+    parallel_for(
+            runs.size(), 4, [&](const std::size_t i) { ++runs[i]; }, two_nodes());
+    for (const auto & count : runs) {
+        EXPECT_EQ(1, count);
+    }
+}
+
+TEST(ParallelReduce, combines_in_range_order)
+{
+    // Concatenation isn't commutative, so the order of combines shows
+    const auto map = [](const std::size_t begin, const std::size_t end) {
+        std::string text;
+        for (std::size_t i = begin; i < end; ++i) {
+            text += static_cast<char>('a' + i % 26);
+        }
+        return text;
+    };
+    const auto combine = [](std::string a, const std::string & b) { return a + b; };
+    const std::string expected = ">" + map(0, 100);
+    for (const unsigned threads : {1u, 3u, 8u, 200u}) {
+        EXPECT_EQ(expected, parallel_reduce(std::size_t{100}, threads, std::string(">"), map, combine));
+        EXPECT_EQ(expected, parallel_reduce(std::size_t{100}, threads, std::string(">"), map, combine, two_nodes()));
+    }
+    EXPECT_EQ(">", parallel_reduce(std::size_t{0}, 4, std::string(">"), map, combine));
+}
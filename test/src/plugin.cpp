@@ -0,0 +1,113 @@
+#include "calc.h"
+#include "calc_plugin.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+int clamp(double * left, const double right)
+{
+    if (right < 0) {
+        return 1;
+    }
+    *left = std::fmax(-right, std::fmin(*left, right));
+    return 0;
+}
+
+int twice(double * left, double)
+{
+    *left *= 2;
+    return 0;
+}
+
+class Plugin : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        ASSERT_EQ(CALC_PLUGIN_OK, calc_load_plugin(CALC_TEST_PLUGIN));
+        const calc_operator clamp_op = {"CLAMP", 2, clamp, nullptr, 0, 0, 0};
+        ASSERT_EQ(CALC_PLUGIN_OK, calc_register_operator(&clamp_op));
+        const calc_operator twice_op = {"TWICE", 1, twice, nullptr, 0, 0, 0};
+        ASSERT_EQ(CALC_PLUGIN_OK, calc_register_operator(&twice_op));
+    }
+};
+
+} // anonymous namespace
+
+TEST_F(Plugin, registration)
+{
+    const calc_operator duplicate = {"MIN", 2, clamp, nullptr, 0, 0, 0};
+    EXPECT_EQ(CALC_PLUGIN_DUPLICATE, calc_register_operator(&duplicate));
+    const calc_operator builtin = {"SQRT2", 1, twice, nullptr, 0, 0, 0};
+    EXPECT_EQ(CALC_PLUGIN_BAD_OPERATOR, calc_register_operator(&builtin));
+    const calc_operator digit = {"1X", 1, twice, nullptr, 0, 0, 0};
+    EXPECT_EQ(CALC_PLUGIN_BAD_OPERATOR, calc_register_operator(&digit));
+    const calc_operator space = {"A B", 1, twice, nullptr, 0, 0, 0};
+    EXPECT_EQ(CALC_PLUGIN_BAD_OPERATOR, calc_register_operator(&space));
+    const calc_operator ternary = {"TERN", 3, twice, nullptr, 0, 0, 0};
+    EXPECT_EQ(CALC_PLUGIN_BAD_OPERATOR, calc_register_operator(&ternary));
+    const calc_operator no_kernel = {"NOP", 1, nullptr, nullptr, 0, 0, 0};
+    EXPECT_EQ(CALC_PLUGIN_BAD_OPERATOR, calc_register_operator(&no_kernel));
+    EXPECT_EQ(CALC_PLUGIN_LOAD_FAILED, calc_load_plugin("/nonexistent/plugin.so"));
+}
+
+TEST_F(Plugin, binary)
+{
+    EXPECT_DOUBLE_EQ(3, process_line(5, "MIN 3"));
+    EXPECT_DOUBLE_EQ(3, process_line(3, "MIN5"));
+    EXPECT_DOUBLE_EQ(-2, process_line(-7, "CLAMP 2"));
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(7, process_line(7, "MIN 1 2"));
+    EXPECT_EQ("Argument parsing error at 5: ' 2'\n", testing::internal::GetCapturedStderr());
+}
+
+TEST_F(Plugin, unary)
+{
+    EXPECT_DOUBLE_EQ(0, process_line(1, "LN"));
+    EXPECT_DOUBLE_EQ(8, process_line(4, "TWICE"));
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(-1, process_line(-1, "LN"));
+    EXPECT_EQ("Bad argument for LN: -1\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(4, process_line(4, "TWICE 2"));
+    EXPECT_EQ("Unexpected suffix for a unary operation: ' 2'\n", testing::internal::GetCapturedStderr());
+}
+
+TEST_F(Plugin, fold)
+{
+    EXPECT_DOUBLE_EQ(1, process_line(10, "(MIN) 5 1 3"));
+    EXPECT_DOUBLE_EQ(17, process_line(10, "(MAX) 5 17 3 "));
+    EXPECT_DOUBLE_EQ(10, process_line(10, "(MAX) 5"));
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(10, process_line(10, "(MAX 5"));
+    EXPECT_EQ("Incorrect folded operation specified (MAX 5\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(10, process_line(10, "(CLAMP) 20 -1"));
+    EXPECT_FALSE(testing::internal::GetCapturedStderr().empty());
+}
+
+TEST_F(Plugin, builtins_unaffected)
+{
+    EXPECT_DOUBLE_EQ(5, process_line(25, "SQRT"));
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(0, process_line(0, "MINUS 1"));
+    EXPECT_EQ("Argument parsing error at 3: 'US 1'\nNo argument for a binary operation\n", testing::internal::GetCapturedStderr());
+    testing::internal::CaptureStderr();
+    EXPECT_DOUBLE_EQ(0, process_line(0, "fix"));
+    EXPECT_EQ("Unknown operation fix\n", testing::internal::GetCapturedStderr());
+}
+
+TEST_F(Plugin, status)
+{
+    double current = -1;
+    EXPECT_EQ(calc::Status::OperationFailed, calc::evaluate(current, "LN"));
+    EXPECT_EQ(-1, current);
+    std::ostringstream err;
+    EXPECT_TRUE(check_line("(MAX) 1 2 3", err));
+    EXPECT_TRUE(check_line("LN", err));
+    EXPECT_FALSE(check_line("LN 1", err));
+}
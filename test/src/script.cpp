@@ -0,0 +1,286 @@
+#include "script.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Line = calc::Script::Line;
+
+// Feeds lines, returning the printed values
+std::vector<double> feed(calc::Script & script, calc::Session & session, const std::vector<std::string> & lines, std::ostream & err)
+{
+    std::vector<double> values;
+    for (const auto & line : lines) {
+        switch (script.feed(session, line, err)) {
+        case Line::Plain:
+            session.eval(line, err);
+            values.push_back(session.value());
+            break;
+        case Line::Evaluated:
+            values.push_back(session.value());
+            break;
+        case Line::Consumed:
+            break;
+        }
+    }
+    return values;
+}
+
+const std::vector<std::string> body = {"+ 1.5", "* 3", "(-) 1 2 0.25", "SQRT", "/ 7", "% 5", "^ 1.1", "_", "(+) 4 4", "/ 0"};
+
+} // anonymous namespace
+
+TEST(Script, call_matches_inline_lines)
+{
+    std::vector<std::string> lines = {"def f {"};
+    lines.insert(lines.end(), body.begin(), body.end());
+    lines.insert(lines.end(), {"}", "2", "call f", "call f x3"});
+    calc::Script script;
+    calc::Session session;
+    std::ostringstream err;
+    const auto values = feed(script, session, lines, err);
+    EXPECT_TRUE(script.defined("f"));
+
+    calc::Session inline_session;
+    std::ostringstream inline_err;
+    std::vector<double> expected = {2};
+    inline_session.eval("2", inline_err);
+    for (const int calls : {1, 3}) {
+        for (int i = 0; i < calls; ++i) {
+            for (const auto & line : body) {
+                inline_session.eval(line, inline_err);
+            }
+        }
+        expected.push_back(inline_session.value());
+    }
+    ASSERT_EQ(expected.size(), values.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        EXPECT_EQ(expected[i], values[i]) << i;
+    }
+    EXPECT_EQ(inline_err.str(), err.str());
+}
+
+TEST(Script, one_line_definitions_and_nested_calls)
+{
+    calc::Script script;
+    calc::Session session;
+    std::ostringstream err;
+    const auto values = feed(script, session, {"def inc { + 1 }", "def twice { call inc; call inc }", "call twice x5; * 2", "+ 1"}, err);
+    EXPECT_EQ((std::vector<double>{20, 21}), values);
+    EXPECT_EQ("", err.str());
+}
+
+TEST(Script, errors)
+{
+    calc::Script script;
+    calc::Session session({}, 7);
+    std::ostringstream err;
+    const auto values = feed(script, session, {"call nothing", "def 1x { + 1 }", "def f + 1", "def g { def h { } }", "def k { + x }", "call k", "def m { + 1", "}", "def n { + 1 } extra", "call m x", "call m x2"}, err);
+    EXPECT_EQ((std::vector<double>{7, 7, 7, 9}), values);
+    EXPECT_EQ("Unknown subroutine 'nothing'\n"
+              "Bad subroutine name '1x'\n"
+              "Expected '{' after def f\n"
+              "Definitions can't be nested\n"
+              "Argument parsing error at 2: 'x'\n"
+              "No argument for a binary operation\n"
+              "Unknown subroutine 'k'\n"
+              "Unexpected text after the body of n: 'extra'\n"
+              "Bad call: 'call m x'\n",
+            err.str());
+    EXPECT_FALSE(script.defined("k"));
+    EXPECT_TRUE(script.defined("m"));
+}
+
+TEST(Script, affine_composition)
+{
+    std::ostringstream err;
+    calc::Script exact, affine(true);
+    calc::Session exact_session({}, 1), affine_session({}, 1);
+    const std::vector<std::string> lines = {"def grow { * 1.0001; + 0.5; (-) 0.25 0.125; / 1.0002; _; _ }", "call grow x1000", "SQRT", "def reset { 3; + 1 }", "call grow; call reset"};
+    const auto expected = feed(exact, exact_session, lines, err);
+    const auto values = feed(affine, affine_session, lines, err);
+    ASSERT_EQ(expected.size(), values.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        EXPECT_NEAR(expected[i], values[i], 1e-12 * std::fabs(expected[i])) << i;
+    }
+    EXPECT_EQ(4, values.back());
+
+    // Composed in O(log N): x -> x + 1 a billion times
+    feed(affine, affine_session, {"def inc { + 1 }", "0", "call inc x1000000000"}, err);
+    EXPECT_EQ(1e9, affine_session.value());
+    EXPECT_EQ("", err.str());
+}
+
+TEST(Script, repeat)
+{
+    calc::Script script;
+    calc::Session session({}, 1);
+    std::ostringstream err;
+    const auto values = feed(script, session, {"repeat 3 { * 2; + 1 }", "def f {", "repeat 2 {", "repeat 2 { + 1 }", "* 3", "}", "}", "call f x2", "repeat 0 { 5 }", "repeat x { + 1 }", "repeat 2 + 1", "repeat 2", "repeat 2 { + 1 } }"}, err);
+    EXPECT_EQ((std::vector<double>{15, 1455, 1455, 1455, 1455, 1455, 1455}), values);
+    EXPECT_EQ("Bad repeat: 'repeat x'\n"
+              "Bad repeat: 'repeat 2 + 1'\n"
+              "Expected '{' after repeat 2\n"
+              "Unexpected '}'\n",
+            err.str());
+}
+
+TEST(Script, repeat_matches_iteration)
+{
+    const std::vector<std::string> lines = {"100", "repeat 100000 { * 1.00001; + 0.25; SQRT; + 3 }", "repeat 1000 { * 1.0001; + 0.5 }"};
+    std::ostringstream err;
+    calc::Script exact, affine(true);
+    calc::Session exact_session, affine_session;
+    const auto exact_values = feed(exact, exact_session, lines, err);
+    const auto affine_values = feed(affine, affine_session, lines, err);
+
+    calc::Session inline_session;
+    inline_session.eval("100", err);
+    for (int i = 0; i < 100000; ++i) {
+        for (const auto * line : {"* 1.00001", "+ 0.25", "SQRT", "+ 3"}) {
+            inline_session.eval(line, err);
+        }
+    }
+    EXPECT_EQ(inline_session.value(), exact_values[1]);
+    EXPECT_EQ(inline_session.value(), affine_values[1]);
+    for (int i = 0; i < 1000; ++i) {
+        inline_session.eval("* 1.0001", err);
+        inline_session.eval("+ 0.5", err);
+    }
+    EXPECT_EQ(inline_session.value(), exact_values[2]);
+    EXPECT_NEAR(inline_session.value(), affine_values[2], 1e-12 * inline_session.value());
+
+    // Closed form: 10^18 iterations of the inner body
+    feed(affine, affine_session, {"0", "repeat 1000000000 { repeat 1000000000 { + 1 } }"}, err);
+    EXPECT_EQ(1e18, affine_session.value());
+    EXPECT_EQ("", err.str());
+}
+
+TEST(Script, unfinished_statement)
+{
+    calc::Script script;
+    calc::Session session({}, 1);
+    std::ostringstream err;
+    const auto values = feed(script, session, {"def f {", "+ 1", "2"}, err);
+    EXPECT_TRUE(values.empty());
+    EXPECT_FALSE(script.finish(err));
+    EXPECT_EQ("Missing '}'\n", err.str());
+    EXPECT_FALSE(script.defined("f"));
+    EXPECT_EQ(1, session.value());
+    // The script is usable again
+    EXPECT_EQ((std::vector<double>{2}), feed(script, session, {"repeat 1 { + 1 }"}, err));
+    EXPECT_TRUE(script.finish(err));
+}
+
+TEST(Script, affine_keeps_nan_and_infinity)
+{
+    // * 0 of an infinite register is NaN, unlike a SET
+    const std::vector<std::string> lines = {"def zero { * 0; + 1 }", "def set { 5; * 2 }", "1", "repeat 40 { * 1000000000 }", "call zero", "1", "repeat 40 { * 1000000000 }", "call set", "repeat 3 { call set; + 1 }"};
+    std::ostringstream err;
+    calc::Script exact, affine(true);
+    calc::Session exact_session, affine_session;
+    const auto expected = feed(exact, exact_session, lines, err);
+    const auto values = feed(affine, affine_session, lines, err);
+    ASSERT_EQ(expected.size(), values.size());
+    EXPECT_TRUE(std::isinf(values[1]));
+    EXPECT_TRUE(std::isnan(values[2]));
+    EXPECT_EQ(10, values[5]);
+    EXPECT_EQ(11, values[6]);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        EXPECT_EQ(std::isnan(expected[i]), std::isnan(values[i])) << i;
+        if (!std::isnan(expected[i])) {
+            EXPECT_EQ(expected[i], values[i]) << i;
+        }
+    }
+}
+
+TEST(Script, limits)
+{
+    calc::Limits limits;
+    limits.line.max_time = std::chrono::milliseconds(1);
+    calc::Script script;
+    calc::Session session(limits, 4);
+    std::ostringstream err;
+    // Stops long before the loop is done and leaves the register unchanged
+    EXPECT_EQ((std::vector<double>{4}), feed(script, session, {"repeat 1000000000000 { SQRT }"}, err));
+    EXPECT_EQ(0u, err.str().rfind("Time limit exceeded after ", 0)) << err.str();
+    EXPECT_EQ(1u, session.admission().aborted_time);
+
+    // Statements count against the session budgets and are rejected after them
+    limits = {};
+    limits.max_bytes = 10;
+    calc::Session budgeted(limits, 4);
+    err.str("");
+    EXPECT_EQ((std::vector<double>{16, 16}), feed(script, budgeted, {"repeat 2 { * 2 }", "repeat 2 { * 2 }"}, err));
+    EXPECT_EQ("Session limit exceeded, line rejected\n", err.str());
+    EXPECT_EQ(1u, budgeted.admission().rejected_session);
+}
+
+TEST(Script, affine_keeps_underflow)
+{
+    // 0.5^2000 underflows to 0: composed, an infinite register would become
+    // NaN and a huge one 0, while the steps one by one keep inf and ~8.7e-303
+    const std::vector<std::string> lines = {"repeat 40 { * 1000000000 }", "repeat 2000 { * 0.5 }", "10", "^ 300", "repeat 2000 { * 0.5 }", "10", "^ 300", "repeat 1000 { * 0.5 }; repeat 1000 { * 0.5 }", "(*) 0.5 0.5"};
+    std::ostringstream err;
+    calc::Script exact, affine(true);
+    calc::Session exact_session({}, 9), affine_session({}, 9);
+    const auto expected = feed(exact, exact_session, lines, err);
+    const auto values = feed(affine, affine_session, lines, err);
+    EXPECT_EQ("", err.str());
+    ASSERT_EQ(expected.size(), values.size());
+    EXPECT_TRUE(std::isinf(values[1]));
+    EXPECT_GT(values[4], 0);
+    EXPECT_EQ(expected, values);
+}
+
+TEST(Script, affine_call_power_keeps_underflow)
+{
+    const std::vector<std::string> lines = {"def f { * 0.5 }", "repeat 40 { * 1000000000 }", "call f x2000", "10", "^ 300", "call f x2000", "call f x1000"};
+    std::ostringstream err;
+    calc::Script exact, affine(true);
+    calc::Session exact_session({}, 9), affine_session({}, 9);
+    const auto expected = feed(exact, exact_session, lines, err);
+    const auto values = feed(affine, affine_session, lines, err);
+    EXPECT_EQ("", err.str());
+    ASSERT_EQ(expected.size(), values.size());
+    EXPECT_TRUE(std::isinf(values[1]));
+    EXPECT_EQ(expected, values);
+}
+
+TEST(Script, body_limits)
+{
+    calc::Limits limits;
+    limits.line.max_arguments = 3;
+    calc::Script script;
+    calc::Session session(limits, 1);
+    std::ostringstream err;
+    EXPECT_EQ((std::vector<double>{}), feed(script, session, {"def f { + 1; (+) 1 2 3 }", "def g { + 1; (+) 1 2 }"}, err));
+    EXPECT_EQ("Too many arguments, limit 3\n", err.str());
+    EXPECT_FALSE(script.defined("f"));
+    EXPECT_TRUE(script.defined("g"));
+
+    // Nested loops and chains of calls are bounded
+    err.str("");
+    std::string deep;
+    for (std::size_t i = 0; i <= calc::Script::max_nesting; ++i) {
+        deep += "repeat 1 { ";
+    }
+    deep += "+ 1" + std::string(calc::Script::max_nesting + 1, '}');
+    EXPECT_EQ((std::vector<double>{1}), feed(script, session, {deep}, err));
+    EXPECT_EQ("Calls and loops nested too deep, limit 64\n", err.str());
+    err.str("");
+    std::vector<std::string> chain = {"def f0 { + 1 }"};
+    for (std::size_t i = 1; i <= calc::Script::max_nesting + 1; ++i) {
+        chain.push_back("def f" + std::to_string(i) + " { call f" + std::to_string(i - 1) + " }");
+    }
+    feed(script, session, chain, err);
+    EXPECT_EQ("Calls and loops nested too deep, limit 64\n", err.str());
+    EXPECT_TRUE(script.defined("f64"));
+    EXPECT_FALSE(script.defined("f65"));
+}
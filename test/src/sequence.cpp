@@ -0,0 +1,47 @@
+#include "sequence.h"
+#include "session.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> split(const std::string_view line)
+{
+    std::vector<std::string> operations;
+    calc::for_each_operation(line, [&](const std::string_view operation) { operations.emplace_back(operation); });
+    return operations;
+}
+
+} // anonymous namespace
+
+TEST(Sequence, split)
+{
+    EXPECT_EQ((std::vector<std::string>{"+ 1", "* 2", "SQRT"}), split("+ 1; * 2; SQRT"));
+    EXPECT_EQ((std::vector<std::string>{"(+) 1 2", "_"}), split(" (+) 1 2 ;_"));
+    EXPECT_EQ((std::vector<std::string>{"+ 1", "_"}), split("+ 1;; \t ; _ ;"));
+    EXPECT_EQ((std::vector<std::string>{}), split(";"));
+    // Without separators the line is kept as is, errors included
+    EXPECT_EQ((std::vector<std::string>{"+ 1 "}), split("+ 1 "));
+    EXPECT_EQ((std::vector<std::string>{""}), split(""));
+}
+
+TEST(Sequence, same_as_separate_lines)
+{
+    calc::Session sequence, lines;
+    const std::string_view line = "+ 16; * 2; SQRT; / 0; (-) 1 2; x; _";
+    std::ostringstream sequence_err, lines_err;
+    calc::for_each_operation(line, [&](const std::string_view operation) { sequence.eval(operation, sequence_err); });
+    for (const char * operation : {"+ 16", "* 2", "SQRT", "/ 0", "(-) 1 2", "x", "_"}) {
+        lines.eval(operation, lines_err);
+    }
+    EXPECT_EQ(lines.value(), sequence.value());
+    EXPECT_EQ(-(std::sqrt(32.0) - 3), sequence.value());
+    EXPECT_EQ(lines_err.str(), sequence_err.str());
+    EXPECT_EQ(7, sequence.admission().admitted);
+}
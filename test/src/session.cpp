@@ -0,0 +1,108 @@
+#include "session.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::string long_fold(const std::size_t args)
+{
+    std::string line = "(^)";
+    for (std::size_t i = 0; i < args; ++i) {
+        line += " 1.0000001";
+    }
+    return line;
+}
+
+} // anonymous namespace
+
+TEST(Session, unlimited)
+{
+    calc::Session session;
+    EXPECT_EQ(calc::Status::Ok, session.eval("(+) 1 2 3"));
+    EXPECT_EQ(calc::Status::DivisionByZero, session.eval("/ 0"));
+    EXPECT_DOUBLE_EQ(6, session.value());
+    EXPECT_EQ(2, session.admission().admitted);
+    EXPECT_EQ(12, session.admission().bytes);
+}
+
+TEST(Session, line_bytes)
+{
+    calc::Limits limits;
+    limits.line.max_bytes = 5;
+    calc::Session session(limits, 1);
+    std::ostringstream err;
+    EXPECT_EQ(calc::Status::Ok, session.eval("+ 123", err));
+    EXPECT_EQ(calc::Status::LineTooLong, session.eval("+ 1234", err));
+    EXPECT_EQ("Line too long: 6 bytes, limit 5\n", err.str());
+    EXPECT_EQ(calc::Status::LineTooLong, session.reject_too_long(1 << 30, err));
+    EXPECT_DOUBLE_EQ(124, session.value());
+    EXPECT_EQ(1, session.admission().admitted);
+    EXPECT_EQ(2, session.admission().rejected_too_long);
+}
+
+TEST(Session, arguments)
+{
+    calc::Limits limits;
+    limits.line.max_arguments = 3;
+    calc::Session session(limits, 1);
+    std::ostringstream err;
+    EXPECT_EQ(calc::Status::Ok, session.eval("(+) 1 2 3", err));
+    EXPECT_EQ(calc::Status::TooManyArguments, session.eval("(+) 1 2 3 4", err));
+    EXPECT_EQ("Too many arguments, limit 3\n", err.str());
+    EXPECT_DOUBLE_EQ(7, session.value());
+    EXPECT_EQ(1, session.admission().aborted_arguments);
+}
+
+TEST(Session, line_time)
+{
+    calc::Limits limits;
+    limits.line.max_time = std::chrono::nanoseconds(1);
+    calc::Session session(limits, 2);
+    std::ostringstream err;
+    EXPECT_EQ(calc::Status::Ok, session.eval("(^) 1 1", err));
+    EXPECT_EQ(calc::Status::TimeLimitExceeded, session.eval(long_fold(5000), err));
+    EXPECT_EQ("Time limit exceeded after 1024 arguments\n", err.str());
+    EXPECT_DOUBLE_EQ(2, session.value());
+    EXPECT_EQ(1, session.admission().aborted_time);
+}
+
+TEST(Session, session_bytes)
+{
+    calc::Limits limits;
+    limits.max_bytes = 10;
+    calc::Session session(limits);
+    EXPECT_EQ(calc::Status::Ok, session.eval("(+) 1 2 3"));
+    EXPECT_EQ(calc::Status::Ok, session.eval("+ 1"));
+    EXPECT_EQ(calc::Status::SessionExhausted, session.eval("+ 1"));
+    EXPECT_DOUBLE_EQ(7, session.value());
+    EXPECT_EQ(1, session.admission().rejected_session);
+}
+
+TEST(Session, session_time)
+{
+    calc::Limits limits;
+    limits.max_time = std::chrono::nanoseconds(1);
+    calc::Session session(limits);
+    EXPECT_EQ(calc::Status::Ok, session.eval(long_fold(1000)));
+    EXPECT_GT(session.admission().time.count(), 0);
+    EXPECT_EQ(calc::Status::SessionExhausted, session.eval("+ 1"));
+}
+
+TEST(Session, line_bounded_by_session_time)
+{
+    // A single long line stops when the session budget runs out, not only
+    // the next line is rejected
+    calc::Limits limits;
+    limits.line.max_time = std::chrono::seconds(100);
+    limits.max_time = std::chrono::nanoseconds(1);
+    calc::Session session(limits, 2);
+    std::ostringstream err;
+    EXPECT_EQ(calc::Status::TimeLimitExceeded, session.eval(long_fold(5000), err));
+    EXPECT_EQ("Time limit exceeded after 1024 arguments\n", err.str());
+    EXPECT_DOUBLE_EQ(2, session.value());
+    EXPECT_EQ(1, session.admission().aborted_time);
+    EXPECT_EQ(calc::Status::SessionExhausted, session.eval("+ 1"));
+}
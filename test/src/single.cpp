@@ -0,0 +1,96 @@
+#include "batch.h"
+#include "output.h"
+#include "session.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+TEST(Single, float_arithmetic)
+{
+    float current = 0;
+    EXPECT_EQ(calc::Status::Ok, calc::evaluate(current, "(+) 0.1 0.2"));
+    EXPECT_EQ(0.1f + 0.2f, current);
+    EXPECT_EQ(calc::Status::Ok, calc::evaluate(current, "/ 3"));
+    EXPECT_EQ((0.1f + 0.2f) / 3.0f, current);
+    EXPECT_EQ(calc::Status::Ok, calc::evaluate(current, "SQRT"));
+    EXPECT_EQ(std::sqrt((0.1f + 0.2f) / 3.0f), current);
+
+    // Arguments are parsed like for double and rounded once
+    EXPECT_EQ(calc::Status::Ok, calc::evaluate(current, "1234567891"));
+    EXPECT_EQ(1234567891.0f, current);
+
+    const float before = current;
+    std::ostringstream err;
+    EXPECT_EQ(calc::Status::DivisionByZero, calc::evaluate(current, "(/) 2 0", err));
+    EXPECT_EQ("Bad right argument for division: 0\n", err.str());
+    EXPECT_EQ(before, current);
+    EXPECT_EQ(calc::Status::Ok, calc::evaluate(current, "_"));
+    EXPECT_EQ(calc::Status::BadSqrt, calc::evaluate(current, "SQRT"));
+    EXPECT_EQ(-before, current);
+}
+
+TEST(Single, accuracy)
+{
+    // Short chains of well conditioned operations stay within a few float ulps
+    const char * const lines[] = {"+ 1.5", "- 0.25", "* 1.1", "/ 1.3", "(+) 1 2 3", "(*) 0.9 1.1"};
+    std::mt19937 rng(1);
+    double wide = 1;
+    float narrow = 1;
+    for (std::size_t i = 0; i < 100; ++i) {
+        const std::string_view line = lines[rng() % std::size(lines)];
+        calc::evaluate(wide, line);
+        calc::evaluate(narrow, line);
+        EXPECT_NEAR(wide, narrow, std::abs(wide) * 1e-5) << i << ": " << line;
+    }
+}
+
+TEST(Single, session)
+{
+    calc::Session session({}, 0.1);
+    session.set_single_precision(true);
+    EXPECT_EQ(0.1f, session.value());
+    EXPECT_EQ(calc::Status::Ok, session.eval("* 3"));
+    EXPECT_EQ(0.1f * 3.0f, session.value());
+    EXPECT_EQ(1, session.admission().admitted);
+}
+
+TEST(Single, batch_matches_scalar_engine)
+{
+    const char * const lines[] = {"+ 1", "- 2.5", "* 3", "/ 4", "/ 0", "% 3", "% 0", "^ 2", "_", "SQRT", "17", "(+) 1 2", "fix"};
+    std::mt19937 rng(1);
+    std::vector<std::string_view> batch;
+    std::vector<float> registers;
+    for (std::size_t i = 0; i < 3000; ++i) {
+        batch.push_back(lines[rng() % std::size(lines)]);
+        registers.push_back(static_cast<float>(rng() % 200) - 100.5f);
+    }
+    auto expected = registers;
+    std::vector<calc::Status> expected_statuses;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        expected_statuses.push_back(calc::evaluate(expected[i], batch[i]));
+    }
+    std::vector<calc::Status> statuses(batch.size());
+    calc::evaluate_batch(registers.data(), batch.data(), batch.size(), statuses.data());
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        EXPECT_EQ(expected[i], registers[i]) << i << ": " << batch[i];
+        EXPECT_EQ(expected_statuses[i], statuses[i]) << i << ": " << batch[i];
+    }
+}
+
+TEST(Single, formats_like_ostream)
+{
+    std::ostringstream expected;
+    std::string formatted;
+    char buffer[max_value_length];
+    for (const float value : {0.0f, -0.0f, 0.1f, 1.0f / 3.0f, 1e-30f, 3.4e38f, 16777217.0f, -123456.7f}) {
+        expected << value << '\n';
+        formatted.append(buffer, format_value(buffer, value));
+    }
+    EXPECT_EQ(expected.str(), formatted);
+}
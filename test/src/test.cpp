@@ -2,6 +2,8 @@
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+
 TEST(Calc, err)
 {
     testing::internal::CaptureStderr();
@@ -278,3 +280,13 @@ TEST(Calc, fold_rem)
     EXPECT_DOUBLE_EQ(7, process_line(7, "(((((%))))) 10 100"));
     EXPECT_FALSE(testing::internal::GetCapturedStderr().empty());
 }
+
+TEST(Calc, fold_repeated_divisor)
+{
+    // Repeated divisors are precomputed, results stay those of / and fmod
+    EXPECT_EQ(1.0 / 3 / 3 / 3, process_line(1, "(/) 3 3 3"));
+    EXPECT_EQ(-1e300 / 4 / 4 / 4 / 4, process_line(-1e300, "(/) 4 4 4 4"));
+    EXPECT_EQ(std::fmod(std::fmod(-123456789, 1000), 7), process_line(-123456789, "(%) 1000 7 7 7"));
+    EXPECT_EQ(std::fmod(std::fmod(12345.678, 0.25), 0.25), process_line(12345.678, "(%) 0.25 0.25"));
+    EXPECT_TRUE(std::signbit(process_line(-24, "(%) 4 4")));
+}
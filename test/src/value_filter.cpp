@@ -0,0 +1,45 @@
+#include "value_filter.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace {
+
+const std::vector<double> values = {1, 2, 2, 6, -4, -4, 4, -0.0, 0};
+
+std::vector<double> kept(ValueFilter filter)
+{
+    std::vector<double> result;
+    for (const double value : values) {
+        if (filter.keep(value)) {
+            result.push_back(value);
+        }
+    }
+    double last;
+    if (filter.last(last)) {
+        result.push_back(last);
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+TEST(ValueFilter, modes)
+{
+    EXPECT_EQ(values, kept({}));
+    EXPECT_EQ((std::vector<double>{0}), kept({ValueFilter::Mode::Final, 0, 0}));
+    EXPECT_EQ((std::vector<double>{2, -4, 0}), kept({ValueFilter::Mode::Every, 3, 0}));
+    // -0 and 0 print differently
+    EXPECT_EQ((std::vector<double>{1, 2, 6, -4, 4, -0.0, 0}), kept({ValueFilter::Mode::Changes, 0, 0}));
+    EXPECT_EQ((std::vector<double>{2, 6, -4, 4, -0.0, 0}), kept({ValueFilter::Mode::Changes, 0, 1}));
+    EXPECT_EQ((std::vector<double>{-4, 4}), kept({ValueFilter::Mode::Crossing, 0, 0}));
+    EXPECT_EQ((std::vector<double>{6, -4, 4, -0.0}), kept({ValueFilter::Mode::Crossing, 3, 0}));
+}
+
+TEST(ValueFilter, final_without_values)
+{
+    ValueFilter filter(ValueFilter::Mode::Final, 0, 5);
+    double last;
+    EXPECT_FALSE(filter.last(last));
+}
@@ -0,0 +1,35 @@
+#include "worker_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+namespace {
+
+struct Counter : WorkerPool::Task
+{
+    explicit Counter(std::atomic<int> & total)
+        : total(total)
+    {
+        run = [](WorkerPool::Task & task) { ++static_cast<Counter &>(task).total; };
+    }
+
+    std::atomic<int> & total;
+};
+
+} // anonymous namespace
+
+TEST(WorkerPool, runs_every_task)
+{
+    std::atomic<int> total{0};
+    std::vector<Counter> tasks(1000, Counter(total));
+    {
+        WorkerPool pool(4);
+        EXPECT_EQ(4, pool.size());
+        for (auto & task : tasks) {
+            pool.submit(task);
+        }
+    }
+    EXPECT_EQ(1000, total);
+}